@@ -0,0 +1,676 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_LIBBPF
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include "taskiter.skel.h"
+#endif
+#include "backend.h"
+#include "cgroup.h"
+#include "common.h"
+#include "namespace.h"
+#include "process.h"
+#include "profile.h"
+#include "taskiter.h"
+
+/*
+ * Four backends are provided:
+ *  - procfs: the live procfs. The namespace files are nsfs files, so
+ *    the nsfs ioctls and setns(2) work on them.
+ *  - dir:    a copy of procfs in a directory, e.g. one made by
+ *    tools/mkprocfs. The files are read the same way, but the kernel
+ *    is never asked about the namespaces.
+ *  - memory: a directory that is loaded in memory once, before the
+ *    scan. The scan then makes no system calls, so that the cost of
+ *    nscat's own data structures can be measured on its own.
+ *  - bpf:    the live procfs, but the status, name, owner and namespaces
+ *    of every process are read at once by a BPF task iterator before
+ *    the scan. The other files are read from procfs. It needs a build
+ *    with HAVE_LIBBPF, root and a kernel with BTF; nscat falls back to
+ *    procfs otherwise.
+ */
+
+/**
+ * @name fs_walk - Call a handler for every process directory.
+ * @param root: The procfs mount point.
+ * @param handler: The handler.
+ * @return RET_OK on success, or the first error of the handler.
+ */
+static int fs_walk(const char *root, pid_handler_t handler) {
+  char proc_path[BUFFER_SIZE];
+  struct dirent *entry;
+  pid_t pid;
+  DIR *dir;
+  int status = RET_OK;
+
+  PROFILE_COUNT(opens, 1);
+  if (!(dir = opendir(root))) {
+    report_error(root, strerror(errno), ERROR_MSG);
+    return RET_ERR_NOFILE;
+  }
+  while ((entry = readdir(dir))) {
+    if (!(pid = atoi(entry->d_name)))
+      continue;
+    snprintf(proc_path, sizeof(proc_path), "%s/%d", root, pid);
+    if ((status = handler(proc_path, pid)) != RET_OK)
+      break;
+  }
+  closedir(dir);
+  return status;
+}
+
+/**
+ * @name fs_read_attr - Read a file of a process.
+ * @param proc_path: The process path.
+ * @param attr: The name of the file, e.g. PROCSTATUSFILE.
+ * @param buffer: The buffer where the contents will be placed. They
+ *                are terminated with a null character.
+ * @param size: The size of the buffer.
+ * @param length: Pointer to the length of the contents.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int fs_read_attr(const char *proc_path, const char *attr, char *buffer,
+			const size_t size, size_t *length) {
+  char target_path[BUFFER_SIZE];
+  ssize_t n;
+  int fd;
+
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path, attr);
+  PROFILE_COUNT(opens, 1);
+  if ((fd = open(target_path, O_RDONLY|O_CLOEXEC)) < 0) {
+    report_error(target_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+  // procfs returns small files in one read, but a copy may not.
+  *length = 0;
+  while (*length < size - 1 &&
+	 (n = read(fd, buffer + *length, size - 1 - *length)) > 0)
+    *length += n;
+  close(fd);
+  PROFILE_COUNT(bytes, *length);
+  buffer[*length] = 0;
+  return RET_OK;
+}
+
+/**
+ * @name fs_get_owner - Get the owner of a process.
+ * @param proc_path: The process path.
+ * @param uid: Pointer to the user ID.
+ * @param gid: Pointer to the group ID.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int fs_get_owner(const char *proc_path, uid_t *uid, gid_t *gid) {
+  struct stat sb;
+
+  PROFILE_COUNT(stats, 1);
+  if (stat(proc_path, &sb)) {
+    report_error(proc_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOLINK;
+  }
+  *uid = sb.st_uid;
+  *gid = sb.st_gid;
+  return RET_OK;
+}
+
+/**
+ * @name fs_get_namespaces - Read the IDs of all the namespaces of a process.
+ * @param proc_path: The process path.
+ * @param nids: An array of NSMAX IDs, indexed by the namespace type.
+ *              The IDs of the missing types are set to 0.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The ns directory is read once and each link is resolved relative to
+ * it with readlinkat(2), which returns the "type:[inode]" target without
+ * a path lookup per namespace. If the links cannot be read, e.g. in an
+ * unusual copy of procfs, the inode is taken from fstatat(2).
+ */
+static int fs_get_namespaces(const char *proc_path, ino_t *nids) {
+  char target_path[BUFFER_SIZE];
+  char link[64];
+  char *start, *end;
+  struct dirent *entry;
+  struct stat sb;
+  unsigned short type;
+  ssize_t length;
+  DIR *dir;
+
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCNSDIR);
+  PROFILE_COUNT(opens, 1);
+  if (!(dir = opendir(target_path))) {
+    report_error(target_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+  memset(nids, 0, NSMAX * sizeof(ino_t));
+  while ((entry = readdir(dir))) {
+    if (entry->d_name[0] == '.')
+      continue;
+    if ((type = register_ns_type(entry->d_name)) >= NSCOUNT)
+      continue;
+    length = readlinkat(dirfd(dir), entry->d_name, link, sizeof(link) - 1);
+    if (length > 0) {
+      link[length] = 0;
+      if ((start = strstr(link, ":[")))
+	nids[type] = strtoul(start + 2, &end, 10);
+    } else if (errno == EINVAL) {
+      PROFILE_COUNT(stats, 1);
+      if (!fstatat(dirfd(dir), entry->d_name, &sb, 0))
+	nids[type] = sb.st_ino;
+    }
+  }
+  closedir(dir);
+  return RET_OK;
+}
+
+// The files that the memory backend keeps for each process.
+static const char *mem_attrs[] = {
+  PROCSTATUSFILE,
+  PROCNAMEFILE,
+  PROCSTATFILE,
+  PROCCGROUPFILE,
+  PROCUIDMAPFILE,
+  PROCGIDMAPFILE
+};
+#define MEM_ATTRS (sizeof(mem_attrs) / sizeof(mem_attrs[0]))
+
+// A process of the memory backend.
+typedef struct mem_proc {
+  pid_t pid;
+  uid_t uid;
+  gid_t gid;
+  ino_t nids[NSMAX];
+  char *attrs[MEM_ATTRS];
+  size_t lengths[MEM_ATTRS];
+} mem_proc_t;
+
+// The processes of the memory backend, sorted by PID.
+static mem_proc_t *mem_procs = NULL;
+static unsigned long mem_count = 0;
+static unsigned long mem_size = 0;
+
+/**
+ * @name mem_load - Load a process of a directory in memory.
+ * @param proc_path: The process path.
+ * @param pid: The process ID.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int mem_load(const char *proc_path, const pid_t pid) {
+  char buffer[MAP_BUFFER_SIZE];
+  mem_proc_t *m;
+  size_t length;
+  unsigned int i;
+
+  if (mem_count == mem_size) {
+    mem_size = mem_size ? mem_size * 2 : 1024;
+    if (!(m = realloc(mem_procs, mem_size * sizeof(mem_proc_t)))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      return RET_ERR_NOMEM;
+    }
+    mem_procs = m;
+  }
+  m = &(mem_procs[mem_count]);
+  memset(m, 0, sizeof(mem_proc_t));
+  m->pid = pid;
+  if (fs_get_owner(proc_path, &(m->uid), &(m->gid)) != RET_OK ||
+      fs_get_namespaces(proc_path, m->nids) != RET_OK)
+    return RET_OK;
+
+  // Missing files are kept as missing.
+  for (i = 0; i < MEM_ATTRS; i++) {
+    if (fs_read_attr(proc_path, mem_attrs[i], buffer, sizeof(buffer),
+		     &length) != RET_OK)
+      continue;
+    if (!(m->attrs[i] = malloc(length + 1))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      while (i--)
+	safe_free((void **)&(m->attrs[i]));
+      return RET_ERR_NOMEM;
+    }
+    memcpy(m->attrs[i], buffer, length + 1);
+    m->lengths[i] = length;
+  }
+  mem_count++;
+  return RET_OK;
+}
+
+/**
+ * @name compare_mem_proc - Order the memory processes by PID.
+ */
+static int compare_mem_proc(const void *a, const void *b) {
+  const mem_proc_t *x = a, *y = b;
+
+  return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+/**
+ * @name mem_release - Release the memory backend.
+ * @return Void.
+ */
+static void mem_release() {
+  unsigned long i;
+  unsigned int j;
+
+  for (i = 0; i < mem_count; i++)
+    for (j = 0; j < MEM_ATTRS; j++)
+      safe_free((void **)&(mem_procs[i].attrs[j]));
+  safe_free((void **)&mem_procs);
+  mem_count = mem_size = 0;
+}
+
+/**
+ * @name mem_init - Load a copy of procfs in memory.
+ * @param root: The directory of the copy.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int mem_init(const char *root) {
+  int status;
+
+  if ((status = fs_walk(root, mem_load)) != RET_OK) {
+    mem_release();
+    return status;
+  }
+  qsort(mem_procs, mem_count, sizeof(mem_proc_t), compare_mem_proc);
+  return RET_OK;
+}
+
+/**
+ * @name mem_search - Find the memory process of a process path.
+ * @param proc_path: The process path. Its last component is the PID.
+ * @return Pointer to the memory process or NULL if it was not found.
+ */
+static mem_proc_t *mem_search(const char *proc_path) {
+  unsigned long low = 0, high = mem_count, middle;
+  const char *name;
+  pid_t pid;
+
+  name = strrchr(proc_path, '/');
+  pid = atoi(name ? name + 1 : proc_path);
+  while (low < high) {
+    PROFILE_COUNT(probes, 1);
+    middle = low + (high - low) / 2;
+    if (mem_procs[middle].pid == pid)
+      return &(mem_procs[middle]);
+    if (mem_procs[middle].pid < pid)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return NULL;
+}
+
+/**
+ * @name mem_walk - Call a handler for every process in memory.
+ */
+static int mem_walk(const char *root, pid_handler_t handler) {
+  char proc_path[BUFFER_SIZE];
+  unsigned long i;
+  int status;
+
+  for (i = 0; i < mem_count; i++) {
+    snprintf(proc_path, sizeof(proc_path), "%s/%d", root, mem_procs[i].pid);
+    if ((status = handler(proc_path, mem_procs[i].pid)) != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name mem_read_attr - Read a file of a process from memory.
+ */
+static int mem_read_attr(const char *proc_path, const char *attr, char *buffer,
+			 const size_t size, size_t *length) {
+  mem_proc_t *m;
+  unsigned int i;
+
+  if (!(m = mem_search(proc_path)))
+    return RET_ERR_NOFILE;
+  for (i = 0; i < MEM_ATTRS; i++)
+    if (!strcmp(mem_attrs[i], attr))
+      break;
+  if (i == MEM_ATTRS || !m->attrs[i])
+    return RET_ERR_NOFILE;
+  *length = m->lengths[i] < size - 1 ? m->lengths[i] : size - 1;
+  memcpy(buffer, m->attrs[i], *length);
+  buffer[*length] = 0;
+  return RET_OK;
+}
+
+/**
+ * @name mem_get_owner - Get the owner of a process from memory.
+ */
+static int mem_get_owner(const char *proc_path, uid_t *uid, gid_t *gid) {
+  mem_proc_t *m;
+
+  if (!(m = mem_search(proc_path)))
+    return RET_ERR_NOLINK;
+  *uid = m->uid;
+  *gid = m->gid;
+  return RET_OK;
+}
+
+/**
+ * @name mem_get_namespaces - Get the namespace IDs of a process from memory.
+ */
+static int mem_get_namespaces(const char *proc_path, ino_t *nids) {
+  mem_proc_t *m;
+
+  if (!(m = mem_search(proc_path)))
+    return RET_ERR_NOFILE;
+  memcpy(nids, m->nids, NSMAX * sizeof(ino_t));
+  return RET_OK;
+}
+
+// The namespace files of the records of the task iterator, in the
+// order of their IDs.
+static const char *iter_files[TASKITER_NSTYPES] = {
+  "cgroup", "ipc", "mnt", "net", "pid", "user", "uts", "time",
+  "pid_for_children", "time_for_children"
+};
+
+// The processes of the bpf backend, sorted by PID, and the namespace
+// types of their IDs.
+static struct taskiter_record *iter_tasks = NULL;
+static unsigned long iter_count = 0;
+static unsigned short iter_types[TASKITER_NSTYPES];
+
+#ifdef HAVE_LIBBPF
+/**
+ * @name iter_read - Read the records of the task iterator.
+ * @param fd: The iterator file.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The output is read straight into the record array, in large reads,
+ * so that the whole process table costs a few system calls.
+ */
+static int iter_read(const int fd) {
+  struct taskiter_record *t;
+  size_t size = 1024 * sizeof(struct taskiter_record), used = 0;
+  ssize_t n;
+
+  if (!(iter_tasks = malloc(size))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  for (;;) {
+    // Keep a quarter of the array free for the next read.
+    if (size - used < size / 4) {
+      size *= 2;
+      if (!(t = realloc(iter_tasks, size))) {
+	report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+	return RET_ERR_NOMEM;
+      }
+      iter_tasks = t;
+    }
+    if ((n = read(fd, (char *)iter_tasks + used, size - used)) < 0) {
+      if (errno == EAGAIN || errno == EINTR)
+	continue;
+      report_error("iter_read", strerror(errno), DEBUG_MSG);
+      return RET_ERR_NOFILE;
+    }
+    if (!n)
+      break;
+    used += n;
+    PROFILE_COUNT(bytes, n);
+  }
+  iter_count = used / sizeof(struct taskiter_record);
+  return RET_OK;
+}
+
+/**
+ * @name iter_load - Load the task iterator and read its records.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int iter_load() {
+  struct taskiter_bpf *skel;
+  struct bpf_link *link;
+  int fd, status;
+
+  if (!(skel = taskiter_bpf__open_and_load())) {
+    report_error("iter_load", "The task iterator cannot be loaded", DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+  if (!(link = bpf_program__attach_iter(skel->progs.dump_task, NULL))) {
+    report_error("iter_load", "The task iterator cannot be attached", DEBUG_MSG);
+    taskiter_bpf__destroy(skel);
+    return RET_ERR_NOFILE;
+  }
+  PROFILE_COUNT(opens, 1);
+  if ((fd = bpf_iter_create(bpf_link__fd(link))) < 0) {
+    report_error("iter_load", strerror(errno), DEBUG_MSG);
+    status = RET_ERR_NOFILE;
+  } else {
+    status = iter_read(fd);
+    close(fd);
+  }
+  bpf_link__destroy(link);
+  taskiter_bpf__destroy(skel);
+  return status;
+}
+#else
+/**
+ * @name iter_load - Read the records of all processes from the task iterator.
+ * @return RET_ERR_NOFILE, since this build has no BPF support.
+ */
+static int iter_load() {
+  report_error("iter_load", "nscat was built without libbpf", DEBUG_MSG);
+  return RET_ERR_NOFILE;
+}
+#endif
+
+/**
+ * @name compare_iter_task - Order the task iterator records by PID.
+ */
+static int compare_iter_task(const void *a, const void *b) {
+  const struct taskiter_record *x = a, *y = b;
+
+  return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+/**
+ * @name iter_release - Release the bpf backend.
+ * @return Void.
+ */
+static void iter_release() {
+  safe_free((void **)&iter_tasks);
+  iter_count = 0;
+}
+
+/**
+ * @name iter_search - Find the record of a process path.
+ * @param proc_path: The process path. Its last component is the PID.
+ * @return Pointer to the record or NULL if it was not found.
+ *
+ * Only processes have records, so the paths of threads are not found
+ * and are read from procfs.
+ */
+static struct taskiter_record *iter_search(const char *proc_path) {
+  unsigned long low = 0, high = iter_count, middle;
+  const char *name;
+  pid_t pid;
+
+  name = strrchr(proc_path, '/');
+  pid = atoi(name ? name + 1 : proc_path);
+  while (low < high) {
+    PROFILE_COUNT(probes, 1);
+    middle = low + (high - low) / 2;
+    if ((pid_t)iter_tasks[middle].pid == pid)
+      return &(iter_tasks[middle]);
+    if ((pid_t)iter_tasks[middle].pid < pid)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return NULL;
+}
+
+/**
+ * @name iter_init - Read every process through the task iterator.
+ * @param root: The procfs mount point.
+ * @return RET_OK on success, or an error code if the backend cannot be
+ *         used, in which case the caller falls back to procfs.
+ *
+ * The records hold the PIDs of the initial PID namespace, and are only
+ * valid for the procfs of the running system. Both are checked, the
+ * first by looking for nscat itself among the records.
+ */
+static int iter_init(const char *root) {
+  struct statfs sb;
+  char path[BUFFER_SIZE];
+  unsigned short i;
+  int status;
+
+  if (statfs(root, &sb) || sb.f_type != PROC_SUPER_MAGIC) {
+    report_error(root, "The bpf backend needs the live procfs", DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+  if ((status = iter_load()) != RET_OK) {
+    iter_release();
+    return status;
+  }
+  if (iter_count && iter_tasks[0].size != sizeof(struct taskiter_record)) {
+    report_error("iter_init", "The task iterator records do not match", DEBUG_MSG);
+    iter_release();
+    return RET_ERR_NOFILE;
+  }
+  qsort(iter_tasks, iter_count, sizeof(struct taskiter_record), compare_iter_task);
+  snprintf(path, sizeof(path), "/%d", getpid());
+  if (!iter_search(path)) {
+    report_error("iter_init", "The bpf backend needs the initial PID namespace",
+		 DEBUG_MSG);
+    iter_release();
+    return RET_ERR_NOFILE;
+  }
+  for (i = 0; i < TASKITER_NSTYPES; i++)
+    iter_types[i] = register_ns_type(iter_files[i]);
+  return RET_OK;
+}
+
+/**
+ * @name iter_walk - Call a handler for every process of the task iterator.
+ */
+static int iter_walk(const char *root, pid_handler_t handler) {
+  char proc_path[BUFFER_SIZE];
+  unsigned long i;
+  int status;
+
+  for (i = 0; i < iter_count; i++) {
+    snprintf(proc_path, sizeof(proc_path), "%s/%u", root, iter_tasks[i].pid);
+    if ((status = handler(proc_path, iter_tasks[i].pid)) != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name iter_read_attr - Read a file of a process from its record.
+ *
+ * The status and comm files are rebuilt from the record, with the
+ * fields that nscat reads. The name is the task comm, so the longer
+ * names that procfs shows for kernel workers are cut short. Any other
+ * file is read from procfs.
+ */
+static int iter_read_attr(const char *proc_path, const char *attr, char *buffer,
+			  const size_t size, size_t *length) {
+  struct taskiter_record *t;
+  size_t used;
+  unsigned int i;
+
+  if (!(t = iter_search(proc_path)))
+    return fs_read_attr(proc_path, attr, buffer, size, length);
+  if (!strcmp(attr, PROCNAMEFILE)) {
+    used = snprintf(buffer, size, "%.*s\n", TASKITER_COMMLEN, t->comm);
+  } else if (!strcmp(attr, PROCSTATUSFILE)) {
+    used = snprintf(buffer, size, "Name:\t%.*s\nTgid:\t%u\nPid:\t%u\n"
+		    "PPid:\t%u\nUid:\t%u\nGid:\t%u\nNSpid:", TASKITER_COMMLEN,
+		    t->comm, t->tgid, t->pid, t->ppid, t->uid, t->gid);
+    for (i = 0; i < t->levels && i < TASKITER_PIDLEVELS && used < size; i++)
+      used += snprintf(buffer + used, size - used, "\t%u", t->nspid[i]);
+    if (used < size)
+      used += snprintf(buffer + used, size - used, "\nThreads:\t%u\n", t->threads);
+  } else {
+    return fs_read_attr(proc_path, attr, buffer, size, length);
+  }
+  *length = used < size ? used : size - 1;
+  return RET_OK;
+}
+
+/**
+ * @name iter_get_owner - Get the owner of a process from its record.
+ */
+static int iter_get_owner(const char *proc_path, uid_t *uid, gid_t *gid) {
+  struct taskiter_record *t;
+
+  if (!(t = iter_search(proc_path)))
+    return fs_get_owner(proc_path, uid, gid);
+  *uid = t->uid;
+  *gid = t->gid;
+  return RET_OK;
+}
+
+/**
+ * @name iter_get_namespaces - Get the namespace IDs of a process from its record.
+ */
+static int iter_get_namespaces(const char *proc_path, ino_t *nids) {
+  struct taskiter_record *t;
+  unsigned short i;
+
+  if (!(t = iter_search(proc_path)))
+    return fs_get_namespaces(proc_path, nids);
+  memset(nids, 0, NSMAX * sizeof(ino_t));
+  for (i = 0; i < TASKITER_NSTYPES; i++)
+    if (iter_types[i] < NSCOUNT)
+      nids[iter_types[i]] = t->nids[i];
+  return RET_OK;
+}
+
+static const backend_t backends[] = {
+  {"procfs", 1, NULL, NULL, fs_walk, fs_read_attr, fs_get_owner, fs_get_namespaces},
+  {"dir", 0, NULL, NULL, fs_walk, fs_read_attr, fs_get_owner, fs_get_namespaces},
+  {"memory", 0, mem_init, mem_release, mem_walk, mem_read_attr, mem_get_owner,
+   mem_get_namespaces},
+  {"bpf", 1, iter_init, iter_release, iter_walk, iter_read_attr, iter_get_owner,
+   iter_get_namespaces},
+  {NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL}
+};
+
+const backend_t *backend = &(backends[0]);
+
+/**
+ * @name select_backend - Select the backend by its name.
+ * @param name: procfs, dir, memory or bpf.
+ * @return RET_OK on success, RET_ERR_PARAM if the name is unknown.
+ */
+int select_backend(const char *name) {
+  unsigned int i;
+
+  if (!name)
+    return RET_ERR_PARAM;
+  for (i = 0; backends[i].name; i++)
+    if (!strcmp(backends[i].name, name)) {
+      backend = &(backends[i]);
+      return RET_OK;
+    }
+  return RET_ERR_PARAM;
+}
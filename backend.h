@@ -0,0 +1,46 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_BACKEND_H
+#define NSCAT_BACKEND_H
+
+#include <sys/types.h>
+#include "namespace.h"
+
+// Largest per process file read through a backend, e.g. status.
+#define ATTR_SIZE 4096
+
+// Called for each process that a backend finds.
+typedef int (*pid_handler_t)(const char *proc_path, const pid_t pid);
+
+// A source of process information. The files of a process are named
+// by their procfs names, e.g. PROCSTATUSFILE, relative to proc_path.
+typedef struct backend {
+  const char *name;
+  unsigned short kernel;
+  int (*init)(const char *root);
+  void (*release)();
+  int (*walk)(const char *root, pid_handler_t handler);
+  int (*read_attr)(const char *proc_path, const char *attr, char *buffer,
+		   const size_t size, size_t *length);
+  int (*get_owner)(const char *proc_path, uid_t *uid, gid_t *gid);
+  int (*get_namespaces)(const char *proc_path, ino_t *nids);
+} backend_t;
+
+// The backend in use. The default is the live procfs.
+extern const backend_t *backend;
+
+int select_backend(const char *name);
+
+#endif
@@ -0,0 +1,94 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+/*
+ * A BPF task iterator that writes one struct taskiter_record for each
+ * process of the system. nscat reads all of them from one iterator file
+ * instead of opening several procfs files per process. The kernel types
+ * are read with CO-RE, so the program runs on any kernel with BTF and
+ * task iterators (Linux 5.8 or later). Build with:
+ *
+ *	bpftool btf dump file /sys/kernel/btf/vmlinux format c > bpf/vmlinux.h
+ *	clang -O2 -g -target bpf -I. -c bpf/taskiter.bpf.c -o bpf/taskiter.bpf.o
+ *	bpftool gen skeleton bpf/taskiter.bpf.o > taskiter.skel.h
+ */
+#include "vmlinux.h"
+#include <bpf/bpf_core_read.h>
+#include <bpf/bpf_helpers.h>
+#include "taskiter.h"
+
+// bpf_seq_write() is only available to GPL-compatible programs. The
+// LGPL allows this file to be used under the GPL.
+char LICENSE[] SEC("license") = "GPL";
+
+SEC("iter/task")
+int dump_task(struct bpf_iter__task *ctx) {
+  struct seq_file *seq = ctx->meta->seq;
+  struct task_struct *task = ctx->task;
+  struct taskiter_record r = {};
+  struct nsproxy *nsproxy;
+  struct pid *pid;
+  struct upid upid;
+  unsigned int level, i;
+
+  // The iterator visits every thread. Only the thread group leaders are
+  // processes.
+  if (!task || BPF_CORE_READ(task, pid) != BPF_CORE_READ(task, tgid))
+    return 0;
+
+  r.size = sizeof(r);
+  r.pid = BPF_CORE_READ(task, pid);
+  r.tgid = BPF_CORE_READ(task, tgid);
+  r.ppid = BPF_CORE_READ(task, real_parent, tgid);
+  r.uid = BPF_CORE_READ(task, real_cred, euid.val);
+  r.gid = BPF_CORE_READ(task, real_cred, egid.val);
+  r.threads = BPF_CORE_READ(task, signal, nr_threads);
+  r.start_time = BPF_CORE_READ(task, start_boottime);
+  BPF_CORE_READ_STR_INTO(&r.comm, task, comm);
+
+  // The user namespace is that of the objective credentials, as in
+  // /proc/PID/ns/user.
+  r.nids[TASKITER_USER] = BPF_CORE_READ(task, real_cred, user_ns, ns.inum);
+
+  // The PID namespace is that of the innermost PID. The PIDs of the
+  // outer levels are kept for the NSpid field.
+  pid = BPF_CORE_READ(task, thread_pid);
+  level = BPF_CORE_READ(pid, level);
+  bpf_core_read(&upid, sizeof(upid), &pid->numbers[level]);
+  r.nids[TASKITER_PID] = BPF_CORE_READ(upid.ns, ns.inum);
+  for (i = 0; i < TASKITER_PIDLEVELS && i <= level; i++) {
+    bpf_core_read(&upid, sizeof(upid), &pid->numbers[i]);
+    r.nspid[i] = upid.nr;
+  }
+  r.levels = i;
+
+  // A zombie has no namespace proxy left.
+  if ((nsproxy = BPF_CORE_READ(task, nsproxy))) {
+    r.nids[TASKITER_CGROUP] = BPF_CORE_READ(nsproxy, cgroup_ns, ns.inum);
+    r.nids[TASKITER_IPC] = BPF_CORE_READ(nsproxy, ipc_ns, ns.inum);
+    r.nids[TASKITER_MNT] = BPF_CORE_READ(nsproxy, mnt_ns, ns.inum);
+    r.nids[TASKITER_NET] = BPF_CORE_READ(nsproxy, net_ns, ns.inum);
+    r.nids[TASKITER_UTS] = BPF_CORE_READ(nsproxy, uts_ns, ns.inum);
+    r.nids[TASKITER_PID_FOR_CHILDREN] =
+      BPF_CORE_READ(nsproxy, pid_ns_for_children, ns.inum);
+    if (bpf_core_field_exists(nsproxy->time_ns)) {
+      r.nids[TASKITER_TIME] = BPF_CORE_READ(nsproxy, time_ns, ns.inum);
+      r.nids[TASKITER_TIME_FOR_CHILDREN] =
+	BPF_CORE_READ(nsproxy, time_ns_for_children, ns.inum);
+    }
+  }
+
+  bpf_seq_write(seq, &r, sizeof(r));
+  return 0;
+}
@@ -0,0 +1,358 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "backend.h"
+#include "cgroup.h"
+#include "common.h"
+#include "info.h"
+#include "namespace.h"
+#include "process.h"
+#include "profile.h"
+
+// cgroup name prefixes of the container runtimes. The names end in
+// ".scope" with the systemd cgroup driver.
+static const struct {
+  const char *prefix;
+  const char *runtime;
+} runtimes[] = {
+  {"docker-", "docker"},
+  {"cri-containerd-", "containerd"},
+  {"crio-conmon-", "cri-o"},
+  {"crio-", "cri-o"},
+  {"libpod-conmon-", "podman"},
+  {"libpod-", "podman"},
+  {NULL, NULL}
+};
+
+/**
+ * @name is_container_id - Check if a cgroup name is a container ID.
+ * @param name: The name.
+ * @param length: The length of the name.
+ * @return 1 if the name consists of CONTAINER_ID_LEN hex digits, 0 otherwise.
+ */
+static int is_container_id(const char *name, const size_t length) {
+  size_t i;
+
+  if (length != CONTAINER_ID_LEN)
+    return 0;
+  for (i = 0; i < length; i++)
+    if (!isxdigit((unsigned char)name[i]))
+      return 0;
+  return 1;
+}
+
+/**
+ * @name get_container_id - Extract a container label from a cgroup path.
+ * @param path: The cgroup path.
+ * @param buffer: The buffer where the label will be placed.
+ * @param size: The size of the buffer.
+ * @return RET_OK if a container was found, RET_ERR_NOENTRY otherwise.
+ *
+ * The components of the path are examined from the innermost outwards.
+ * The label is "runtime:id", with the ID shortened as docker prints it.
+ * The following layouts are recognized:
+ *  - docker-ID.scope, cri-containerd-ID.scope, crio-ID.scope and
+ *    libpod-ID.scope (systemd cgroup driver),
+ *  - .../docker/ID and .../ID under kubepods (cgroupfs driver),
+ *  - machine-NAME.scope and scopes under machine.slice (systemd-machined).
+ */
+int get_container_id(const char *path, char *buffer, const size_t size) {
+  const char *end, *start, *name;
+  size_t length, plen;
+  unsigned int i;
+  int scope;
+
+  if (!path || !buffer || !size) {
+    report_error("get_container_id", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  for (end = path + strlen(path); end > path; end = start - 1) {
+    for (start = end; start > path && start[-1] != '/'; start--);
+    length = end - start;
+    if (!length) {
+      if (start == path)
+	break;
+      continue;
+    }
+    scope = length > 6 && !strncmp(end - 6, ".scope", 6);
+    if (scope)
+      length -= 6;
+
+    // Runtimes that name the scope after the container.
+    for (i = 0; runtimes[i].prefix; i++) {
+      plen = strlen(runtimes[i].prefix);
+      if (length > plen && !strncmp(start, runtimes[i].prefix, plen) &&
+	  is_container_id(start + plen, length - plen)) {
+	snprintf(buffer, size, "%s:%.*s", runtimes[i].runtime,
+		 CONTAINER_ID_SHORT, start + plen);
+	return RET_OK;
+      }
+    }
+
+    // A bare ID, named after its parent directory.
+    if (!scope && is_container_id(start, length)) {
+      for (name = start - 1; name > path && name[-1] != '/'; name--);
+      if (start - name - 1 == 6 && !strncmp(name, "docker", 6))
+	snprintf(buffer, size, "docker:%.*s", CONTAINER_ID_SHORT, start);
+      else
+	snprintf(buffer, size, "container:%.*s", CONTAINER_ID_SHORT, start);
+      return RET_OK;
+    }
+
+    // systemd-machined containers, e.g. systemd-nspawn or libvirt.
+    if (scope) {
+      if (length > 8 && !strncmp(start, "machine-", 8)) {
+	snprintf(buffer, size, "machine:%.*s", (int)(length - 8), start + 8);
+	return RET_OK;
+      }
+      if (strstr(path, "/machine.slice/") &&
+	  strstr(path, "/machine.slice/") + 15 == start) {
+	snprintf(buffer, size, "machine:%.*s", (int)length, start);
+	return RET_OK;
+      }
+    }
+    if (start == path)
+      break;
+  }
+  return RET_ERR_NOENTRY;
+}
+
+/**
+ * @name hash_cgroup_path - Hash a cgroup path (FNV-1a).
+ */
+static unsigned long hash_cgroup_path(const char *path) {
+  unsigned long h = 2166136261UL;
+
+  while (*path)
+    h = (h ^ (unsigned char)*path++) * 16777619UL;
+  return h;
+}
+
+/**
+ * @name grow_cgroup_table - Double the size of the cgroup table.
+ * @param table: Pointer to the table.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int grow_cgroup_table(cgroup_table_t *table) {
+  cgroup_t **slots;
+  unsigned long i, slot, size = table->size * 2;
+
+  if (!(slots = calloc(size, sizeof(cgroup_t *)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  for (i = 0; i < table->size; i++) {
+    if (!table->slots[i])
+      continue;
+    slot = hash_cgroup_path(table->slots[i]->path) & (size - 1);
+    while (slots[slot])
+      slot = (slot + 1) & (size - 1);
+    slots[slot] = table->slots[i];
+  }
+  safe_free((void **)&(table->slots));
+  table->slots = slots;
+  table->size = size;
+  return RET_OK;
+}
+
+/**
+ * @name intern_cgroup - Find or add a cgroup path in the cgroup table.
+ * @param table: The address of the table. It is created on first use.
+ * @param path: The cgroup path.
+ * @return Pointer to the shared cgroup entry or NULL on error.
+ *
+ * The container label is extracted once, when the path is first seen.
+ */
+cgroup_t *intern_cgroup(cgroup_table_t **table, const char *path) {
+  char container[BUFFER_SIZE];
+  unsigned long slot;
+  cgroup_t *cg;
+
+  if (!table || !path) {
+    report_error("intern_cgroup", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return NULL;
+  }
+
+  if (!(*table)) {
+    if (!(*table = malloc(sizeof(cgroup_table_t)))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      return NULL;
+    }
+    if (!((*table)->slots = calloc(CGROUP_TABLE_SIZE, sizeof(cgroup_t *)))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      safe_free((void **)table);
+      return NULL;
+    }
+    (*table)->size = CGROUP_TABLE_SIZE;
+    (*table)->count = 0;
+  }
+
+  slot = hash_cgroup_path(path) & ((*table)->size - 1);
+  while ((cg = (*table)->slots[slot])) {
+    PROFILE_COUNT(probes, 1);
+    if (!strcmp(cg->path, path))
+      return cg;
+    slot = (slot + 1) & ((*table)->size - 1);
+  }
+
+  // A new path.
+  if (!(cg = malloc(sizeof(cgroup_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return NULL;
+  }
+  cg->container = NULL;
+  if (!(cg->path = strdup(path)) ||
+      (get_container_id(path, container, sizeof(container)) == RET_OK &&
+       !(cg->container = strdup(container)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    safe_free((void **)&(cg->path));
+    safe_free((void **)&cg);
+    return NULL;
+  }
+  (*table)->slots[slot] = cg;
+  (*table)->count++;
+
+  // Keep the load factor under one half.
+  if (2 * (*table)->count >= (*table)->size)
+    grow_cgroup_table(*table);
+  return cg;
+}
+
+/**
+ * @name clear_cgroup_table - Release the cgroup table.
+ * @param table: The address of the table.
+ * @return Void.
+ */
+void clear_cgroup_table(cgroup_table_t **table) {
+  unsigned long i;
+
+  if (!table || !(*table))
+    return;
+  for (i = 0; i < (*table)->size; i++) {
+    if (!(*table)->slots[i])
+      continue;
+    safe_free((void **)&((*table)->slots[i]->path));
+    safe_free((void **)&((*table)->slots[i]->container));
+    safe_free((void **)&((*table)->slots[i]));
+  }
+  safe_free((void **)&((*table)->slots));
+  safe_free((void **)table);
+}
+
+/**
+ * @name get_proc_cgroup - Find the cgroup of a process.
+ * @param proc_path: The process path in procfs.
+ * @param p: Pointer to the process object.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Each line of the cgroup file is "ID:CONTROLLERS:PATH". The path of the
+ * unified hierarchy ("0::") is preferred. On hybrid systems, where it may
+ * be just "/", the name=systemd hierarchy or else the first non-root
+ * path is used.
+ */
+int get_proc_cgroup(const char *proc_path, process_t *p) {
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  char buffer[ATTR_SIZE];
+  char path[BUFFER_SIZE] = "/";
+  char *line, *next, *sep;
+  size_t length;
+  int rank = 0, r, status;
+
+  if (!proc_path || !p) {
+    report_error("get_proc_cgroup", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  if ((status = backend->read_attr(proc_path, PROCCGROUPFILE, buffer,
+				   sizeof(buffer), &length)) != RET_OK)
+    return status;
+  for (line = buffer; rank < 3 && line && *line; line = next) {
+    if ((next = strchr(line, '\n')))
+      *next++ = 0;
+    if (!(sep = strchr(line, ':')) || !(sep = strchr(sep + 1, ':')))
+      continue;
+    if (!strcmp(sep + 1, "/"))
+      continue;
+    if (!strncmp(line, "0::", 3))
+      r = 3;
+    else if (strstr(line, ":name=systemd:"))
+      r = 2;
+    else
+      r = 1;
+    if (r > rank) {
+      snprintf(path, sizeof(path), "%s", sep + 1);
+      rank = r;
+    }
+  }
+
+  // The table is shared by the threads that walk several procfs roots.
+  pthread_mutex_lock(&lock);
+  p->cgroup = intern_cgroup(&(info->cgroups), path);
+  pthread_mutex_unlock(&lock);
+  if (!(p->cgroup))
+    return RET_ERR_NOMEM;
+  return RET_OK;
+}
+
+/**
+ * @name format_ns_containers - List the containers of a namespace.
+ * @param ns: Pointer to the namespace.
+ * @param buffer: The buffer where the list will be placed.
+ * @param size: The size of the buffer.
+ * @return The number of distinct containers found.
+ *
+ * Members in the same cgroup share a cgroup entry, so most members are
+ * matched by a pointer comparison. At most CONTAINER_MAX containers are
+ * listed; any more are shown as "...".
+ */
+int format_ns_containers(const namespace_t *ns, char *buffer, const size_t size) {
+  const char *found[CONTAINER_MAX];
+  unsigned int count = 0, i, more = 0;
+  size_t used = 0;
+  const char *c;
+  list_t *pl;
+
+  if (!ns || !buffer || !size) {
+    report_error("format_ns_containers", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return 0;
+  }
+  buffer[0] = 0;
+
+  for (pl = ns->members; pl; pl = pl->next) {
+    if (!pl->process->cgroup || !(c = pl->process->cgroup->container))
+      continue;
+    for (i = 0; i < count; i++)
+      if (found[i] == c || !strcmp(found[i], c))
+	break;
+    if (i < count)
+      continue;
+    if (count == CONTAINER_MAX) {
+      more = 1;
+      continue;
+    }
+    found[count++] = c;
+    if (used < size)
+      used += snprintf(buffer + used, size - used, "%s%s", count > 1 ? ", " : "", c);
+  }
+  if (more && used < size)
+    snprintf(buffer + used, size - used, ", ...");
+  return count;
+}
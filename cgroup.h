@@ -0,0 +1,55 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_CGROUP_H
+#define NSCAT_CGROUP_H
+
+#include <sys/types.h>
+#include "namespace.h"
+#include "process.h"
+
+// cgroup membership of a process under procfs.
+static const char PROCCGROUPFILE[] = "/cgroup";
+
+// Initial number of slots of the cgroup table (a power of two).
+#define CGROUP_TABLE_SIZE 64
+
+// Length of a full container ID and of its printed prefix.
+#define CONTAINER_ID_LEN   64
+#define CONTAINER_ID_SHORT 12
+
+// Most containers listed for a single namespace.
+#define CONTAINER_MAX      8
+
+// An interned cgroup path and the container it belongs to, if any.
+typedef struct cgroup {
+  char *path;
+  char *container;
+} cgroup_t;
+
+// Table of interned cgroup paths. Processes in the same cgroup share
+// one entry.
+typedef struct cgroup_table {
+  struct cgroup **slots;
+  unsigned long size;
+  unsigned long count;
+} cgroup_table_t;
+
+int get_container_id(const char *path, char *buffer, const size_t size);
+cgroup_t *intern_cgroup(cgroup_table_t **table, const char *path);
+void clear_cgroup_table(cgroup_table_t **table);
+int get_proc_cgroup(const char *proc_path, process_t *p);
+int format_ns_containers(const namespace_t *ns, char *buffer, const size_t size);
+
+#endif
@@ -34,6 +34,8 @@ const char *debug_message(const int error) {
 	return "Cannot read link";
       case RET_ERR_NOENTRY:
 	return "An entry does not exist";
+      case RET_ERR_DEADLINE:
+	return "The deadline was reached";
       default:
 	return "Unknown error";
     }
@@ -37,6 +37,7 @@
 #define RET_ERR_NOFILE  -3
 #define RET_ERR_NOLINK  -4
 #define RET_ERR_NOENTRY -5
+#define RET_ERR_DEADLINE -6
 
 const char *debug_message(const int error);
 void report_error(const char *caller, const char *message,
@@ -0,0 +1,287 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "common.h"
+#include "discover.h"
+#include "info.h"
+#include "namespace.h"
+#include "process.h"
+#include "profile.h"
+
+/**
+ * @name parse_ns_link - Parse a namespace link target.
+ * @param link: A link target such as "net:[4026531992]".
+ * @param type: Pointer to the namespace type that will be set.
+ * @param nid: Pointer to an ino_t where the namespace ID will be placed.
+ * @return RET_OK if the target refers to a known namespace type,
+ *         RET_ERR_NOENTRY otherwise.
+ *
+ * Only the short type prefix is copied, so that targets of other kinds,
+ * e.g. "socket:[...]" or "/dev/null", are rejected without parsing.
+ */
+int parse_ns_link(const char *link, unsigned short *type, ino_t *nid) {
+  char name[16];
+  char *end;
+  unsigned int i;
+
+  if (!link || !type || !nid)
+    return RET_ERR_PARAM;
+
+  for (i = 0; link[i] && link[i] != ':' && i < sizeof(name) - 1; i++)
+    name[i] = link[i];
+  if (link[i] != ':' || link[i + 1] != '[')
+    return RET_ERR_NOENTRY;
+  name[i] = 0;
+  if ((*type = get_type_from_name(name)) >= NSCOUNT)
+    return RET_ERR_NOENTRY;
+  *nid = strtoul(link + i + 2, &end, 10);
+  if (*end != ']' || !(*nid))
+    return RET_ERR_NOENTRY;
+  return RET_OK;
+}
+
+/**
+ * @name add_held_namespace - Add a namespace that was found without a process.
+ * @param type: The namespace type.
+ * @param nid: The namespace ID.
+ * @param ns_path: A path that can be opened to reach the namespace.
+ * @param holder: A description of what keeps the namespace alive.
+ * @param root: The procfs root where the namespace was found.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Namespaces that are already known, either from a member process or
+ * from an earlier mount or descriptor, are skipped.
+ */
+int add_held_namespace(const unsigned short type, const ino_t nid,
+		       const char *ns_path, const char *holder,
+		       const unsigned short root) {
+  namespace_t *ns;
+  int status;
+
+  if (type >= NSCOUNT || !ns_path || !holder) {
+    report_error("add_held_namespace", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  if (info->ns_index) {
+    if (search_ns_index(info->ns_index, type, nid))
+      return RET_OK;
+  } else if (info->namespace[type]) {
+    if (search_namespace_tree(info->namespace[type], get_ns_root(root), nid))
+      return RET_OK;
+  }
+
+  if (!(ns = create_empty_namespace()))
+    return RET_ERR_NOMEM;
+  ns->nid = nid;
+  ns->type = type;
+  ns->root = root;
+  ns->creator_pid = -1;
+  if (!(ns->holder = strdup(holder))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    delete_namespace(&ns);
+    return RET_ERR_NOMEM;
+  }
+  get_ns_relatives(ns_path, ns);
+  if ((status = insert_namespace_tree(&(info->namespace[type]), ns)) != RET_OK) {
+    delete_namespace(&ns);
+    return status;
+  }
+  if (info->args->flags & FLAG_PROGRESS)
+    print_namespace_record(ns, RECORD_NEW);
+  if (info->args->flags & FLAG_STREAM)
+    return insert_ns_index(&(info->ns_index), ns);
+  return RET_OK;
+}
+
+/**
+ * @name scan_proc_mountinfo - Find the namespace files that are bind mounted.
+ * @param proc_path: The path in procfs of a process whose mount
+ *        namespace will be scanned.
+ * @param root: The procfs root of the process.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int scan_proc_mountinfo(const char *proc_path, const unsigned short root) {
+  char target_path[BUFFER_SIZE];
+  char holder[BUFFER_SIZE];
+  char mnt_root[BUFFER_SIZE];
+  char mount_point[BUFFER_SIZE];
+  char fs_type[BUFFER_SIZE];
+  char *line = NULL, *sep;
+  size_t size = 0;
+  unsigned short type;
+  ino_t nid;
+  ssize_t length;
+  FILE *fd;
+  int status = RET_OK;
+
+  if (!proc_path) {
+    report_error("scan_proc_mountinfo", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCMOUNTINFOFILE);
+  PROFILE_COUNT(opens, 1);
+  if (!(fd = fopen(target_path, "r"))) {
+    report_error(target_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+
+  // Each line is: ID PARENT MAJ:MIN ROOT MOUNT_POINT OPTIONS [TAGS] - TYPE ...
+  // The root of an nsfs mount is the namespace link target.
+  while ((length = getline(&line, &size, fd)) != -1) {
+    PROFILE_COUNT(bytes, length);
+    if (!(sep = strstr(line, " - ")))
+      continue;
+    if (sscanf(sep + 3, "%1023s", fs_type) != 1 || strcmp(fs_type, NSFSTYPE))
+      continue;
+    if (sscanf(line, "%*s %*s %*s %1023s %1023s", mnt_root, mount_point) != 2)
+      continue;
+    if (parse_ns_link(mnt_root, &type, &nid) != RET_OK)
+      continue;
+    snprintf(target_path, sizeof(target_path), "%s%s%s", proc_path, PROCROOTDIR,
+	     mount_point);
+    snprintf(holder, sizeof(holder), "bind mount %s", mount_point);
+    if ((status = add_held_namespace(type, nid, target_path, holder, root)) != RET_OK)
+      break;
+  }
+  safe_free((void **)&line);
+  fclose(fd);
+  return status;
+}
+
+/**
+ * @name scan_proc_fds - Find the namespace files a process keeps open.
+ * @param proc_path: The process path in procfs.
+ * @param p: Pointer to the process object.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The descriptors are read relative to the fd directory with readlinkat
+ * into a small buffer. Targets that are paths are rejected by their
+ * first character, so processes with many open files stay cheap.
+ */
+int scan_proc_fds(const char *proc_path, const process_t *p) {
+  char target_path[BUFFER_SIZE];
+  char holder[BUFFER_SIZE];
+  char link[64];
+  struct dirent *entry;
+  unsigned short type;
+  ino_t nid;
+  ssize_t length;
+  DIR *dir;
+  int status = RET_OK;
+
+  if (!proc_path || !p) {
+    report_error("scan_proc_fds", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCFDDIR);
+  PROFILE_COUNT(opens, 1);
+  if (!(dir = opendir(target_path))) {
+    report_error(target_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+
+  while ((entry = readdir(dir))) {
+    if (entry->d_name[0] == '.')
+      continue;
+    if ((length = readlinkat(dirfd(dir), entry->d_name, link, sizeof(link) - 1)) <= 0)
+      continue;
+    link[length] = 0;
+    if (link[0] == '/' || parse_ns_link(link, &type, &nid) != RET_OK)
+      continue;
+    snprintf(target_path, sizeof(target_path), "%s%s/%s", proc_path, PROCFDDIR,
+	     entry->d_name);
+    snprintf(holder, sizeof(holder), "fd %s of %s <%d>", entry->d_name,
+	     p->name ? p->name : "Unknown", p->pid);
+    if ((status = add_held_namespace(type, nid, target_path, holder, p->root)) != RET_OK)
+      break;
+  }
+  closedir(dir);
+  return status;
+}
+
+/**
+ * @name scan_mount_namespaces - Scan the mounts of every mount namespace.
+ * @param tree: Pointer to the mount namespace tree.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int scan_mount_namespaces(const tree_t *tree) {
+  char proc_path[BUFFER_SIZE];
+  int status;
+
+  for (; tree; tree = tree->sibling) {
+    if (tree->namespace && tree->namespace->creator) {
+      get_proc_path(tree->namespace->creator, proc_path, sizeof(proc_path));
+      if ((status = scan_proc_mountinfo(proc_path, tree->namespace->creator->root)) ==
+	  RET_ERR_NOMEM)
+	return status;
+    }
+    if ((status = scan_mount_namespaces(tree->child)) != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name discover_namespaces - Find the namespaces that have no processes.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Namespaces are normally found through the ns links of their member
+ * processes. This pass also finds the namespaces that are kept alive
+ * only by an nsfs bind mount (e.g. under /run/netns) or by an open file
+ * descriptor. They are deduplicated by their inode and added to the
+ * namespace trees with a description of their holder.
+ */
+int discover_namespaces() {
+  char proc_path[BUFFER_SIZE];
+  list_t *l;
+  tree_t *mnt;
+  int status;
+
+  if (!info || !(info->args)) {
+    report_error("discover_namespaces", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  // One member of each mount namespace is enough to see its mounts.
+  // Mount namespaces added during the scan have no member and are skipped.
+  mnt = info->namespace[MNT];
+  if (mnt) {
+    if ((status = scan_mount_namespaces(mnt)) != RET_OK)
+      return status;
+  } else {
+    snprintf(proc_path, sizeof(proc_path), "%s/self", info->args->proc_mnt[0]);
+    if ((status = scan_proc_mountinfo(proc_path, 0)) == RET_ERR_NOMEM)
+      return status;
+  }
+
+  // Open namespace file descriptors. In streaming mode they were
+  // scanned while the processes were collected.
+  if (info->args->flags & FLAG_STREAM)
+    return RET_OK;
+  for (l = info->process; l; l = l->next) {
+    get_proc_path(l->process, proc_path, sizeof(proc_path));
+    if ((status = scan_proc_fds(proc_path, l->process)) == RET_ERR_NOMEM)
+      return status;
+  }
+  return RET_OK;
+}
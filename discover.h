@@ -0,0 +1,38 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_DISCOVER_H
+#define NSCAT_DISCOVER_H
+
+#include <sys/types.h>
+#include "namespace.h"
+#include "process.h"
+
+// mountinfo and fd entries under procfs.
+static const char PROCMOUNTINFOFILE[] = "/mountinfo";
+static const char PROCFDDIR[] = "/fd";
+static const char PROCROOTDIR[] = "/root";
+
+// File system type of namespace files.
+static const char NSFSTYPE[] = "nsfs";
+
+int parse_ns_link(const char *link, unsigned short *type, ino_t *nid);
+int add_held_namespace(const unsigned short type, const ino_t nid,
+		       const char *ns_path, const char *holder,
+		       const unsigned short root);
+int scan_proc_mountinfo(const char *proc_path, const unsigned short root);
+int scan_proc_fds(const char *proc_path, const process_t *p);
+int discover_namespaces();
+
+#endif
@@ -0,0 +1,514 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#include <ctype.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "common.h"
+#include "filter.h"
+#include "namespace.h"
+#include "process.h"
+
+// Parser state.
+typedef struct parser {
+  const char *expression;
+  const char *s;
+  filter_t *f;
+} parser_t;
+
+static int parse_or(parser_t *ps);
+
+/**
+ * @name parse_error - Report a syntax error in a filter expression.
+ * @param ps: Pointer to the parser state.
+ * @param what: A short description of the error.
+ * @return RET_ERR_PARAM.
+ */
+static int parse_error(parser_t *ps, const char *what) {
+  char message[BUFFER_SIZE];
+
+  snprintf(message, sizeof(message), "Invalid filter: %s at offset %ld",
+	   what, (long)(ps->s - ps->expression));
+  report_error(NULL, message, ERROR_MSG);
+  return RET_ERR_PARAM;
+}
+
+/**
+ * @name emit - Append an instruction to the filter program.
+ * @param f: Pointer to the filter object.
+ * @param op: The instruction opcode.
+ * @param field: The field the instruction refers to.
+ * @param value: The numeric operand.
+ * @return Pointer to the new instruction or NULL.
+ */
+static instr_t *emit(filter_t *f, const unsigned short op,
+		     const unsigned short field, const unsigned long value) {
+  instr_t *code;
+
+  if (!(code = realloc(f->code, (f->length + 1) * sizeof(instr_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return NULL;
+  }
+  f->code = code;
+  code = &(f->code[f->length++]);
+  code->op = op;
+  code->field = field;
+  code->value = value;
+  code->string = NULL;
+  code->regex = NULL;
+  if (op < OP_AND)
+    f->fields |= 1 << field;
+  return code;
+}
+
+/**
+ * @name skip_spaces - Skip white space in the expression.
+ * @param ps: Pointer to the parser state.
+ * @return Void.
+ */
+static void skip_spaces(parser_t *ps) {
+  while (isspace((unsigned char)*ps->s))
+    ps->s++;
+}
+
+/**
+ * @name accept - Consume a literal token if it comes next.
+ * @param ps: Pointer to the parser state.
+ * @param token: The literal token.
+ * @return 1 if the token was consumed, 0 otherwise.
+ */
+static unsigned short accept(parser_t *ps, const char *token) {
+  skip_spaces(ps);
+  if (strncmp(ps->s, token, strlen(token)))
+    return 0;
+  ps->s += strlen(token);
+  return 1;
+}
+
+/**
+ * @name read_word - Read an identifier, number or string operand.
+ * @param ps: Pointer to the parser state.
+ * @param word: Buffer of BUFFER_SIZE bytes where the result will be placed.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Operands may be quoted with single or double quotes. Unquoted operands
+ * end at white space, a parenthesis, a comma or a logical operator.
+ */
+static int read_word(parser_t *ps, char *word) {
+  unsigned int i = 0;
+  char quote = 0;
+
+  skip_spaces(ps);
+  if (*ps->s == '"' || *ps->s == '\'')
+    quote = *ps->s++;
+  while (*ps->s && i < BUFFER_SIZE - 1) {
+    if (quote) {
+      if (*ps->s == quote)
+	break;
+    } else if (isspace((unsigned char)*ps->s) || strchr("(),&|!=<>~", *ps->s)) {
+      break;
+    }
+    word[i++] = *ps->s++;
+  }
+  word[i] = 0;
+  if (quote) {
+    if (*ps->s != quote)
+      return parse_error(ps, "unterminated string");
+    ps->s++;
+  }
+  if (!i && !quote)
+    return parse_error(ps, "missing operand");
+  return RET_OK;
+}
+
+/**
+ * @name parse_type_list - Parse a namespace type or a list of types.
+ * @param ps: Pointer to the parser state.
+ * @param mask: Pointer to a bitmask where the types will be added.
+ * @param list: 1 if a parenthesized list is expected, 0 for a single type.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int parse_type_list(parser_t *ps, unsigned long *mask,
+			   const unsigned short list) {
+  char word[BUFFER_SIZE];
+  unsigned short type;
+
+  if (list && !accept(ps, "("))
+    return parse_error(ps, "expected '('");
+  do {
+    if (read_word(ps, word) != RET_OK)
+      return RET_ERR_PARAM;
+    if ((type = get_type_from_name(word)) >= NSCOUNT)
+      return parse_error(ps, "unknown namespace type");
+    *mask |= 1 << type;
+  } while (list && accept(ps, ","));
+  if (list && !accept(ps, ")"))
+    return parse_error(ps, "expected ')'");
+  return RET_OK;
+}
+
+/**
+ * @name parse_comparison - Parse a single field comparison.
+ * @param ps: Pointer to the parser state.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int parse_comparison(parser_t *ps) {
+  char word[BUFFER_SIZE];
+  char *end;
+  unsigned short field, op;
+  unsigned long value = 0;
+  instr_t *in;
+  static const struct {
+    const char *token;
+    unsigned short op;
+  } ops[] = {
+    {"==", OP_EQ}, {"=~", OP_MATCH}, {"=", OP_EQ}, {"!=", OP_NE},
+    {"!~", OP_NMATCH}, {"<=", OP_LE}, {"<", OP_LT}, {">=", OP_GE},
+    {">", OP_GT}, {NULL, 0}
+  };
+  unsigned int i;
+
+  if (read_word(ps, word) != RET_OK)
+    return RET_ERR_PARAM;
+  if (!strcmp(word, "pid"))
+    field = FIELD_PID;
+  else if (!strcmp(word, "ppid"))
+    field = FIELD_PPID;
+  else if (!strcmp(word, "uid"))
+    field = FIELD_UID;
+  else if (!strcmp(word, "gid"))
+    field = FIELD_GID;
+  else if (!strcmp(word, "comm"))
+    field = FIELD_COMM;
+  else if (!strcmp(word, "type"))
+    field = FIELD_TYPE;
+  else
+    return parse_error(ps, "unknown field");
+
+  // Namespace types are compiled into a type set.
+  if (field == FIELD_TYPE) {
+    skip_spaces(ps);
+    if (!strncmp(ps->s, "in", 2) && !isalnum((unsigned char)ps->s[2])) {
+      ps->s += 2;
+      if (parse_type_list(ps, &value, 1) != RET_OK)
+	return RET_ERR_PARAM;
+      return emit(ps->f, OP_IN, field, value) ? RET_OK : RET_ERR_NOMEM;
+    }
+    if (accept(ps, "!="))
+      op = OP_NE;
+    else if (accept(ps, "==") || accept(ps, "="))
+      op = OP_EQ;
+    else
+      return parse_error(ps, "expected '=', '!=' or 'in'");
+    if (parse_type_list(ps, &value, 0) != RET_OK)
+      return RET_ERR_PARAM;
+    if (!emit(ps->f, OP_IN, field, value))
+      return RET_ERR_NOMEM;
+    if (op == OP_NE && !emit(ps->f, OP_NOT, field, 0))
+      return RET_ERR_NOMEM;
+    return RET_OK;
+  }
+
+  for (i = 0; ops[i].token; i++)
+    if (accept(ps, ops[i].token))
+      break;
+  if (!ops[i].token)
+    return parse_error(ps, "expected a comparison operator");
+  op = ops[i].op;
+  if (read_word(ps, word) != RET_OK)
+    return RET_ERR_PARAM;
+
+  if (field == FIELD_COMM) {
+    if (op != OP_EQ && op != OP_NE && op != OP_MATCH && op != OP_NMATCH)
+      return parse_error(ps, "comm supports only =, !=, =~ and !~");
+    if (!(in = emit(ps->f, op, field, 0)))
+      return RET_ERR_NOMEM;
+    if (!(in->string = strdup(word))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      return RET_ERR_NOMEM;
+    }
+    if (op == OP_MATCH || op == OP_NMATCH) {
+      if (!(in->regex = malloc(sizeof(regex_t)))) {
+	report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+	return RET_ERR_NOMEM;
+      }
+      if (regcomp(in->regex, word, REG_EXTENDED|REG_NOSUB)) {
+	safe_free((void **)&(in->regex));
+	return parse_error(ps, "invalid regular expression");
+      }
+    }
+    return RET_OK;
+  }
+
+  if (op == OP_MATCH || op == OP_NMATCH)
+    return parse_error(ps, "=~ and !~ apply only to comm");
+  value = strtoul(word, &end, 10);
+  if (*end != 0)
+    return parse_error(ps, "expected a number");
+  return emit(ps->f, op, field, value) ? RET_OK : RET_ERR_NOMEM;
+}
+
+/**
+ * @name parse_unary - Parse a negation, a group or a comparison.
+ * @param ps: Pointer to the parser state.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int parse_unary(parser_t *ps) {
+  int status;
+
+  if (accept(ps, "!")) {
+    if ((status = parse_unary(ps)) != RET_OK)
+      return status;
+    return emit(ps->f, OP_NOT, 0, 0) ? RET_OK : RET_ERR_NOMEM;
+  }
+  if (accept(ps, "(")) {
+    if ((status = parse_or(ps)) != RET_OK)
+      return status;
+    if (!accept(ps, ")"))
+      return parse_error(ps, "expected ')'");
+    return RET_OK;
+  }
+  return parse_comparison(ps);
+}
+
+/**
+ * @name parse_and - Parse a conjunction.
+ * @param ps: Pointer to the parser state.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int parse_and(parser_t *ps) {
+  int status;
+
+  if ((status = parse_unary(ps)) != RET_OK)
+    return status;
+  while (accept(ps, "&&")) {
+    if ((status = parse_unary(ps)) != RET_OK)
+      return status;
+    if (!emit(ps->f, OP_AND, 0, 0))
+      return RET_ERR_NOMEM;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name parse_or - Parse a disjunction.
+ * @param ps: Pointer to the parser state.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int parse_or(parser_t *ps) {
+  int status;
+
+  if ((status = parse_and(ps)) != RET_OK)
+    return status;
+  while (accept(ps, "||")) {
+    if ((status = parse_and(ps)) != RET_OK)
+      return status;
+    if (!emit(ps->f, OP_OR, 0, 0))
+      return RET_ERR_NOMEM;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name compile_filter - Compile a filter expression.
+ * @param expression: The filter expression in string form.
+ * @return Pointer to a filter object or NULL.
+ *
+ * The expression is compiled once into a postfix program that can be
+ * evaluated cheaply for every process. Comparisons combine the fields
+ * pid, ppid, uid, gid (numeric), comm (=, !=, =~, !~) and type (=, !=,
+ * in (NS,...)) with the operators !, && and || and parentheses.
+ */
+filter_t *compile_filter(const char *expression) {
+  parser_t ps;
+  filter_t *f;
+
+  if (!expression) {
+    report_error("compile_filter", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return NULL;
+  }
+
+  if (!(f = malloc(sizeof(filter_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return NULL;
+  }
+  f->code = NULL;
+  f->length = 0;
+  f->fields = 0;
+
+  ps.expression = ps.s = expression;
+  ps.f = f;
+  if (parse_or(&ps) != RET_OK) {
+    delete_filter(&f);
+    return NULL;
+  }
+  skip_spaces(&ps);
+  if (*ps.s) {
+    parse_error(&ps, "unexpected trailing input");
+    delete_filter(&f);
+    return NULL;
+  }
+  return f;
+}
+
+/**
+ * @name delete_filter - Delete a filter object.
+ * @param f: The address of the filter object.
+ * @return Void.
+ */
+void delete_filter(filter_t **f) {
+  unsigned int i;
+
+  if (!f || !(*f))
+    return;
+
+  for (i = 0; i < (*f)->length; i++) {
+    safe_free((void **)&((*f)->code[i].string));
+    if ((*f)->code[i].regex) {
+      regfree((*f)->code[i].regex);
+      safe_free((void **)&((*f)->code[i].regex));
+    }
+  }
+  safe_free((void **)&((*f)->code));
+  safe_free((void **)f);
+}
+
+/**
+ * @name compare - Apply a numeric comparison.
+ * @return 1 if the comparison holds, 0 otherwise.
+ */
+static unsigned short compare(const unsigned short op, const unsigned long a,
+			      const unsigned long b) {
+  switch (op) {
+    case OP_EQ:
+      return a == b;
+    case OP_NE:
+      return a != b;
+    case OP_LT:
+      return a < b;
+    case OP_LE:
+      return a <= b;
+    case OP_GT:
+      return a > b;
+    case OP_GE:
+      return a >= b;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @name eval_filter - Evaluate a filter for a process.
+ * @param f: Pointer to the filter object.
+ * @param p: Pointer to the process object.
+ * @param known: Bitmask of the fields of p that have been read so far.
+ * @param type: The namespace type, valid if FIELD_TYPE is known.
+ * @return FILTER_TRUE, FILTER_FALSE, or FILTER_UNKNOWN if the result
+ *         depends on fields that are not known yet.
+ *
+ * The evaluation uses three-valued logic, so that a process can be
+ * rejected as soon as enough of its attributes have been read.
+ */
+unsigned short eval_filter(const filter_t *f, const process_t *p,
+			   const unsigned int known, const unsigned short type) {
+  unsigned short stack[f && f->length ? f->length : 1];
+  unsigned short a, b;
+  unsigned int i, top = 0;
+  unsigned long value;
+  const instr_t *in;
+
+  if (!f || !p || !f->length)
+    return FILTER_TRUE;
+
+  for (i = 0; i < f->length; i++) {
+    in = &(f->code[i]);
+    switch (in->op) {
+      case OP_AND:
+	b = stack[--top];
+	a = stack[--top];
+	if (a == FILTER_FALSE || b == FILTER_FALSE)
+	  stack[top++] = FILTER_FALSE;
+	else if (a == FILTER_TRUE && b == FILTER_TRUE)
+	  stack[top++] = FILTER_TRUE;
+	else
+	  stack[top++] = FILTER_UNKNOWN;
+	continue;
+      case OP_OR:
+	b = stack[--top];
+	a = stack[--top];
+	if (a == FILTER_TRUE || b == FILTER_TRUE)
+	  stack[top++] = FILTER_TRUE;
+	else if (a == FILTER_FALSE && b == FILTER_FALSE)
+	  stack[top++] = FILTER_FALSE;
+	else
+	  stack[top++] = FILTER_UNKNOWN;
+	continue;
+      case OP_NOT:
+	if (stack[top-1] != FILTER_UNKNOWN)
+	  stack[top-1] = !stack[top-1];
+	continue;
+    }
+
+    // Comparisons on fields that have not been read yet are unknown.
+    if (!(known & (1 << in->field))) {
+      stack[top++] = FILTER_UNKNOWN;
+      continue;
+    }
+    switch (in->field) {
+      case FIELD_PID:
+	value = p->pid;
+	break;
+      case FIELD_PPID:
+	value = p->ppid;
+	break;
+      case FIELD_UID:
+	value = p->uid;
+	break;
+      case FIELD_GID:
+	value = p->gid;
+	break;
+      case FIELD_TYPE:
+	stack[top++] = (in->value & (1 << type)) ? FILTER_TRUE : FILTER_FALSE;
+	continue;
+      case FIELD_COMM:
+	if (in->op == OP_MATCH || in->op == OP_NMATCH)
+	  a = p->name && !regexec(in->regex, p->name, 0, NULL, 0);
+	else
+	  a = p->name && !strcmp(p->name, in->string);
+	if (in->op == OP_NE || in->op == OP_NMATCH)
+	  a = !a;
+	stack[top++] = a ? FILTER_TRUE : FILTER_FALSE;
+	continue;
+    }
+    stack[top++] = compare(in->op, value, in->value) ? FILTER_TRUE : FILTER_FALSE;
+  }
+  return stack[0];
+}
+
+/**
+ * @name filter_process_types - Find the namespace types a process passes.
+ * @param f: Pointer to the filter object.
+ * @param p: Pointer to a process object whose attributes have been read.
+ * @return A bitmask of the namespace types for which the filter holds.
+ */
+unsigned short filter_process_types(const filter_t *f, const process_t *p) {
+  unsigned short type, types = 0;
+
+  for (type = 0; type < NSCOUNT; type++)
+    if (eval_filter(f, p, FIELD_ALL, type) == FILTER_TRUE)
+      types |= 1 << type;
+  return types;
+}
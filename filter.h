@@ -0,0 +1,73 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_FILTER_H
+#define NSCAT_FILTER_H
+
+#include <regex.h>
+#include <sys/types.h>
+#include "process.h"
+
+// Filter fields. Each field is also a bit in the "known" mask that
+// tells the evaluator which process attributes have been read so far.
+#define FIELD_PID   0
+#define FIELD_PPID  1
+#define FIELD_UID   2
+#define FIELD_GID   3
+#define FIELD_COMM  4
+#define FIELD_TYPE  5
+#define FIELD_ALL   0x3f
+
+// Filter opcodes.
+#define OP_EQ     0
+#define OP_NE     1
+#define OP_LT     2
+#define OP_LE     3
+#define OP_GT     4
+#define OP_GE     5
+#define OP_MATCH  6
+#define OP_NMATCH 7
+#define OP_IN     8
+#define OP_AND    9
+#define OP_OR     10
+#define OP_NOT    11
+
+// Filter results.
+#define FILTER_FALSE   0
+#define FILTER_TRUE    1
+#define FILTER_UNKNOWN 2
+
+// A single instruction of a compiled filter program.
+typedef struct instr {
+  unsigned short op;
+  unsigned short field;
+  unsigned long value;
+  char *string;
+  regex_t *regex;
+} instr_t;
+
+// A filter expression compiled into a postfix program.
+typedef struct filter {
+  struct instr *code;
+  unsigned int length;
+  unsigned int fields;
+} filter_t;
+
+filter_t *compile_filter(const char *expression);
+void delete_filter(filter_t **f);
+unsigned short eval_filter(const filter_t *f, const struct process *p,
+			   const unsigned int known, const unsigned short type);
+unsigned short filter_process_types(const filter_t *f, const struct process *p);
+
+#endif
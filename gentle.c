@@ -0,0 +1,185 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "backend.h"
+#include "common.h"
+#include "gentle.h"
+#include "info.h"
+#include "process.h"
+
+/*
+ * procfs reads take kernel locks of the process that is read, so a
+ * full scan on a loaded node adds latency to its workload. The gentle
+ * mode runs nscat with the idle CPU and I/O priorities and scans the
+ * processes in small batches, yielding the CPU after each one. A rate
+ * limit spreads the batches over time. A wall clock deadline and a
+ * CPU time budget stop the scan early; what was found so far is still
+ * printed. The namespaces of each process are read in the same batch as
+ * the process, so the pace and the limits cover every procfs read that
+ * is made per process.
+ */
+
+// The state of a gentle scan.
+static struct {
+  double wall_start;
+  double cpu_start;
+  unsigned long scanned;
+  unsigned long batch;
+  pid_t last_pid;
+  const char *stopped;
+} scan;
+
+/**
+ * @name get_seconds - Read a clock in seconds.
+ * @param clock: The clock ID.
+ * @return The time in seconds.
+ */
+static double get_seconds(const clockid_t clock) {
+  struct timespec ts;
+
+  if (clock_gettime(clock, &ts))
+    return 0;
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @name is_paced_scan - Check whether the scan is paced or limited.
+ * @return 1 if the processes are collected in paced batches, or 0.
+ */
+int is_paced_scan() {
+  return (info->args->flags & FLAG_GENTLE) || info->args->deadline > 0 ||
+    info->args->cpu_budget > 0;
+}
+
+/**
+ * @name lower_priority - Run with the idle CPU and I/O priorities.
+ * @return Void.
+ *
+ * The threads that are started later inherit both. Failures are not
+ * fatal; the scan is still paced.
+ */
+void lower_priority() {
+  struct sched_param param;
+
+  memset(&param, 0, sizeof(param));
+  if (sched_setscheduler(0, SCHED_IDLE, &param))
+    report_error("lower_priority", strerror(errno), DEBUG_MSG);
+  if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+	      IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT))
+    report_error("lower_priority", strerror(errno), DEBUG_MSG);
+}
+
+/**
+ * @name pace_scan - Pause between two batches of processes.
+ * @return RET_OK to go on with the scan, or RET_ERR_DEADLINE if the
+ *         deadline or the CPU budget was reached.
+ */
+static int pace_scan() {
+  struct timespec ts;
+  double elapsed, ahead;
+
+  elapsed = get_seconds(CLOCK_MONOTONIC) - scan.wall_start;
+  if (info->args->deadline > 0 && elapsed >= info->args->deadline) {
+    scan.stopped = "Deadline";
+    return RET_ERR_DEADLINE;
+  }
+  if (info->args->cpu_budget > 0 &&
+      get_seconds(CLOCK_PROCESS_CPUTIME_ID) - scan.cpu_start >=
+      info->args->cpu_budget) {
+    scan.stopped = "CPU budget";
+    return RET_ERR_DEADLINE;
+  }
+
+  // Sleep off the time the scan is ahead of its rate.
+  if (info->args->rate) {
+    ahead = (double)scan.scanned / info->args->rate - elapsed;
+    if (info->args->deadline > 0 && elapsed + ahead > info->args->deadline)
+      ahead = info->args->deadline - elapsed;
+    if (ahead > 0) {
+      ts.tv_sec = (time_t)ahead;
+      ts.tv_nsec = (long)((ahead - ts.tv_sec) * 1e9);
+      nanosleep(&ts, NULL);
+    }
+  }
+  if (info->args->flags & FLAG_GENTLE)
+    sched_yield();
+  return RET_OK;
+}
+
+/**
+ * @name gentle_proc_entry - Process a process found by the backend, gently.
+ * @param fpath: The process path.
+ * @param pid: The process ID.
+ * @return RET_OK to continue with the next process, RET_ERR_DEADLINE
+ *         if the scan ran out of time, or an error code.
+ */
+int gentle_proc_entry(const char *fpath, const pid_t pid) {
+  int status;
+
+  if (scan.scanned && !(scan.scanned % scan.batch))
+    if ((status = pace_scan()) != RET_OK)
+      return status;
+  scan.scanned++;
+  scan.last_pid = pid;
+  return handle_proc_entry(fpath, pid);
+}
+
+/**
+ * @name collect_processes_gently - Collect the processes in paced batches.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * If the scan runs out of time, how far it got is reported and the
+ * processes found so far are kept.
+ */
+int collect_processes_gently() {
+  unsigned short root;
+  int status;
+
+  if (!info || !(info->args)) {
+    report_error("collect_processes_gently", debug_message(RET_ERR_PARAM),
+		 DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  // About ten pauses per second at the requested rate.
+  scan.batch = GENTLE_BATCH;
+  if (info->args->rate && info->args->rate / 10 < scan.batch)
+    scan.batch = info->args->rate / 10 ? info->args->rate / 10 : 1;
+  scan.scanned = 0;
+  scan.stopped = NULL;
+  scan.wall_start = get_seconds(CLOCK_MONOTONIC);
+  scan.cpu_start = get_seconds(CLOCK_PROCESS_CPUTIME_ID);
+
+  // The roots are walked one after the other, so that the pace and the
+  // limits hold for the whole scan.
+  for (root = 0, status = RET_OK; root < info->args->nroots && status == RET_OK; root++) {
+    set_walk_target(root, NULL);
+    status = backend->walk(info->args->proc_mnt[root], gentle_proc_entry);
+  }
+  set_walk_target(0, NULL);
+  if (status == RET_ERR_DEADLINE) {
+    fprintf(stderr, "nscat: %s reached after %lu processes in %.2f s, the last "
+	    "one PID %d. The output is partial.\n", scan.stopped, scan.scanned,
+	    get_seconds(CLOCK_MONOTONIC) - scan.wall_start, scan.last_pid);
+    return RET_OK;
+  }
+  return status;
+}
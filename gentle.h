@@ -0,0 +1,33 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_GENTLE_H
+#define NSCAT_GENTLE_H
+
+#include <sys/types.h>
+
+// Largest number of processes scanned between two pauses.
+#define GENTLE_BATCH 32
+
+// I/O priority of the idle class, as in linux/ioprio.h.
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+int is_paced_scan();
+void lower_priority();
+int gentle_proc_entry(const char *fpath, const pid_t pid);
+int collect_processes_gently();
+
+#endif
@@ -0,0 +1,351 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cgroup.h"
+#include "common.h"
+#include "graph.h"
+#include "info.h"
+#include "namespace.h"
+#include "process.h"
+
+/*
+ * The graph is written in a single pass over the namespace trees and
+ * the process list, without holding it in memory. Its nodes are the
+ * namespaces and, with -r, the processes. Its edges are:
+ *   parent: from a namespace to each of its child namespaces,
+ *   owner:  from a namespace to the user namespace that owns it,
+ *   member: from a process to each namespace it belongs to.
+ * The parent edges come from the tree links and the member edges from
+ * the namespace array of each process. The owners are looked up in a
+ * hash index of the user namespaces.
+ */
+
+/**
+ * @name is_exported_type - Check if a namespace type is part of the graph.
+ * @param type: The namespace type.
+ * @return 1 if the user requested the type, 0 otherwise.
+ */
+static unsigned short is_exported_type(const unsigned short type) {
+  return !(info->args->flags & FLAG_NSWANT) || info->args->wanted[type];
+}
+
+/**
+ * @name print_escaped - Print a string inside a DOT or XML string.
+ * @param s: The string.
+ * @return Void.
+ *
+ * Process names and holders may contain any character. Control
+ * characters, which neither format accepts, are printed as '?'.
+ */
+static void print_escaped(const char *s) {
+  for (; *s; s++) {
+    if ((unsigned char)*s < ' ') {
+      putchar('?');
+      continue;
+    }
+    if (info->args->format == FORMAT_DOT) {
+      if (*s == '"' || *s == '\\')
+	putchar('\\');
+      putchar(*s);
+      continue;
+    }
+    switch (*s) {
+      case '&':
+	fputs("&amp;", stdout);
+	break;
+      case '<':
+	fputs("&lt;", stdout);
+	break;
+      case '>':
+	fputs("&gt;", stdout);
+	break;
+      case '"':
+	fputs("&quot;", stdout);
+	break;
+      default:
+	putchar(*s);
+    }
+  }
+}
+
+/**
+ * @name print_node_id - Print the ID of a graph node.
+ * @param ns: Pointer to a namespace, or NULL if the node is a process.
+ * @param p: Pointer to a process, used if ns is NULL.
+ * @return Void.
+ *
+ * Namespaces are named "ns:TYPE:NID" and processes "pid:PID". The
+ * procfs root is appended, e.g. "pid:42@1", where the IDs of several
+ * roots may collide.
+ */
+static void print_node_id(const namespace_t *ns, const process_t *p) {
+  if (ns) {
+    printf("ns:%s:%lu", get_name_from_type(ns->type), ns->nid);
+    if (info->args->flags & FLAG_SPLITROOTS)
+      printf("@%hu", ns->root);
+  } else {
+    printf("pid:%d", p->pid);
+    if (info->args->nroots > 1)
+      printf("@%hu", p->root);
+  }
+}
+
+/**
+ * @name print_edge - Print a graph edge.
+ * @param from: The source namespace, or NULL if the source is a process.
+ * @param member: The source process, used if from is NULL.
+ * @param to: The target namespace.
+ * @param relation: The edge relation: parent, owner or member.
+ * @return Void.
+ */
+static void print_edge(const namespace_t *from, const process_t *member,
+		       const namespace_t *to, const char *relation) {
+  if (info->args->format == FORMAT_DOT) {
+    printf("  \"");
+    print_node_id(from, member);
+    printf("\" -> \"");
+    print_node_id(to, NULL);
+    if (!strcmp(relation, "owner"))
+      printf("\" [style=dashed, label=\"owner\"];\n");
+    else if (!strcmp(relation, "member"))
+      printf("\" [style=dotted];\n");
+    else
+      printf("\";\n");
+  } else {
+    printf("    <edge source=\"");
+    print_node_id(from, member);
+    printf("\" target=\"");
+    print_node_id(to, NULL);
+    printf("\"><data key=\"relation\">%s</data></edge>\n", relation);
+  }
+}
+
+/**
+ * @name print_ns_node - Print the graph node of a namespace.
+ * @param ns: Pointer to the namespace.
+ * @return Void.
+ */
+static void print_ns_node(const namespace_t *ns) {
+  char containers[BUFFER_SIZE];
+  unsigned short has_containers;
+
+  has_containers = (info->args->flags & FLAG_CONTAINER) &&
+    format_ns_containers(ns, containers, sizeof(containers));
+  if (info->args->format == FORMAT_DOT) {
+    printf("  \"");
+    print_node_id(ns, NULL);
+    printf("\" [label=\"%s %lu\\n%lu members", get_name_from_type(ns->type),
+	   ns->nid, ns->nmembers);
+    if (ns->holder) {
+      printf("\\n");
+      print_escaped(ns->holder);
+    }
+    if (has_containers) {
+      printf("\\n");
+      print_escaped(containers);
+    }
+    printf("\"];\n");
+    return;
+  }
+
+  printf("    <node id=\"");
+  print_node_id(ns, NULL);
+  printf("\"><data key=\"kind\">namespace</data>"
+	 "<data key=\"type\">%s</data><data key=\"nid\">%lu</data>"
+	 "<data key=\"members\">%lu</data>", get_name_from_type(ns->type),
+	 ns->nid, ns->nmembers);
+  if (info->args->flags & FLAG_SPLITROOTS)
+    printf("<data key=\"root\">%hu</data>", ns->root);
+  if (ns->holder) {
+    printf("<data key=\"holder\">");
+    print_escaped(ns->holder);
+    printf("</data>");
+  }
+  if (has_containers) {
+    printf("<data key=\"containers\">");
+    print_escaped(containers);
+    printf("</data>");
+  }
+  if (info->args->flags & FLAG_ACCOUNT)
+    printf("<data key=\"utime\">%lu</data><data key=\"stime\">%lu</data>"
+	   "<data key=\"rss_kib\">%lu</data>", ns->utime, ns->stime,
+	   ns->rss * (sysconf(_SC_PAGESIZE) / 1024));
+  printf("</node>\n");
+}
+
+/**
+ * @name print_process_node - Print the graph node of a process.
+ * @param p: Pointer to the process.
+ * @return Void.
+ */
+static void print_process_node(const process_t *p) {
+  const char *name = p->name ? p->name : "";
+
+  if (info->args->format == FORMAT_DOT) {
+    printf("  \"");
+    print_node_id(NULL, p);
+    printf("\" [shape=ellipse, label=\"");
+    print_escaped(name);
+    printf(" <%d>\"];\n", p->pid);
+    return;
+  }
+
+  printf("    <node id=\"");
+  print_node_id(NULL, p);
+  printf("\"><data key=\"kind\">process</data><data key=\"pid\">%d</data>"
+	 "<data key=\"comm\">", p->pid);
+  print_escaped(name);
+  printf("</data>");
+  if (info->args->nroots > 1)
+    printf("<data key=\"root\">%hu</data>", p->root);
+  printf("</node>\n");
+}
+
+/**
+ * @name print_graph_tree - Print the nodes and edges of a namespace tree.
+ * @param tree: Pointer to a namespace tree.
+ * @param owners: Index of the exported user namespaces, or NULL.
+ * @return Void.
+ *
+ * A child is linked with its tree parent only if that is its actual
+ * parent. Orphaned namespaces, which the tree keeps under its root,
+ * get no parent edge.
+ */
+static void print_graph_tree(const tree_t *tree, const ns_index_t *owners) {
+  const namespace_t *ns, *owner;
+  const tree_t *c;
+
+  for (; tree; tree = tree->sibling) {
+    if ((ns = tree->namespace)) {
+      print_ns_node(ns);
+      for (c = tree->child; c; c = c->sibling)
+	if (c->namespace && c->namespace->pnid == ns->nid &&
+	    !is_orphaned_namespace(c->namespace))
+	  print_edge(ns, NULL, c->namespace, "parent");
+      if (owners && ns->type != USER && ns->owner &&
+	  (owner = search_ns_index(owners, USER, ns->owner)))
+	print_edge(ns, NULL, owner, "owner");
+    }
+    print_graph_tree(tree->child, owners);
+  }
+}
+
+/**
+ * @name index_user_namespaces - Add the namespaces of a tree to an index.
+ * @param tree: Pointer to a namespace tree.
+ * @param index: The address of the index.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+static int index_user_namespaces(const tree_t *tree, ns_index_t **index) {
+  int status;
+
+  for (; tree; tree = tree->sibling) {
+    if (tree->namespace)
+      if ((status = insert_ns_index(index, tree->namespace)) != RET_OK)
+	return status;
+    if ((status = index_user_namespaces(tree->child, index)) != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name print_graph_header - Print the beginning of the graph.
+ * @return Void.
+ */
+static void print_graph_header() {
+  unsigned int i;
+  const char *keys[][3] = {
+    {"kind", "node", "string"},
+    {"type", "node", "string"},
+    {"nid", "node", "long"},
+    {"members", "node", "long"},
+    {"root", "node", "int"},
+    {"holder", "node", "string"},
+    {"containers", "node", "string"},
+    {"utime", "node", "long"},
+    {"stime", "node", "long"},
+    {"rss_kib", "node", "long"},
+    {"pid", "node", "int"},
+    {"comm", "node", "string"},
+    {"relation", "edge", "string"}
+  };
+
+  if (info->args->format == FORMAT_DOT) {
+    printf("digraph nscat {\n");
+    printf("  node [shape=box];\n");
+    return;
+  }
+  printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+  printf("<graphml xmlns=\"%s\">\n", GRAPHMLNS);
+  for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+    printf("  <key id=\"%s\" for=\"%s\" attr.name=\"%s\" attr.type=\"%s\"/>\n",
+	   keys[i][0], keys[i][1], keys[i][0], keys[i][2]);
+  printf("  <graph id=\"nscat\" edgedefault=\"directed\">\n");
+}
+
+/**
+ * @name print_graph - Print the namespaces as a DOT or GraphML graph.
+ * @return Void.
+ */
+void print_graph() {
+  ns_index_t *owners = NULL;
+  unsigned short type;
+  list_t *l;
+
+  if (!info || !(info->args))
+    return;
+
+  // The owners are user namespaces, so owner edges are only drawn when
+  // the user namespaces are part of the graph. In streaming mode every
+  // namespace is already indexed.
+  if (is_exported_type(USER)) {
+    if (info->ns_index)
+      owners = info->ns_index;
+    else if (index_user_namespaces(info->namespace[USER], &owners) != RET_OK) {
+      clear_ns_index(&owners);
+      return;
+    }
+  }
+
+  print_graph_header();
+  for (type = 0; type < NSCOUNT; type++)
+    if (is_exported_type(type))
+      print_graph_tree(info->namespace[type], owners);
+
+  // The processes, each with an edge to every exported namespace it is
+  // a member of.
+  if (info->args->flags & FLAG_PROCESS)
+    for (l = info->process; l; l = l->next) {
+      for (type = 0; type < NSCOUNT; type++)
+	if (is_exported_type(type) && l->process->namespace[type])
+	  break;
+      if (type == NSCOUNT)
+	continue;
+      print_process_node(l->process);
+      for (; type < NSCOUNT; type++)
+	if (is_exported_type(type) && l->process->namespace[type])
+	  print_edge(NULL, l->process, l->process->namespace[type], "member");
+    }
+
+  if (info->args->format == FORMAT_DOT)
+    printf("}\n");
+  else
+    printf("  </graph>\n</graphml>\n");
+  if (owners != info->ns_index)
+    clear_ns_index(&owners);
+}
@@ -0,0 +1,23 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_GRAPH_H
+#define NSCAT_GRAPH_H
+
+// GraphML namespace.
+static const char GRAPHMLNS[] = "http://graphml.graphdrawing.org/xmlns";
+
+void print_graph();
+
+#endif
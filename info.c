@@ -11,29 +11,146 @@
  * Foundation.  See file LICENSE.
  *
  */
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include "backend.h"
+#include "cgroup.h"
 #include "common.h"
+#include "discover.h"
+#include "filter.h"
+#include "graph.h"
 #include "info.h"
+#include "metrics.h"
 #include "namespace.h"
 #include "process.h"
+#include "profile.h"
+#include "stats.h"
 
 info_t *info;
 
+// Names of the output formats, indexed by their codes.
+static const char *formats[FORMAT_COUNT] = {"tree", "dot", "graphml", "openmetrics"};
+
+// The namespace types that are left to build, shared by the threads
+// that build the trees.
+typedef struct build_pool {
+  ino_t (*nids)[NSMAX];
+  unsigned short next;
+  int status;
+  pthread_mutex_t lock;
+  profile_t *profile;
+} build_pool_t;
+
 /**
  * @name clear_args - Clear the arguments.
  * @param args: The address of the arguments object.
  * @return Void.
  */
 void clear_args(callargs_t **args) {
+  unsigned short i;
+
   if (!args || !(*args))
     return;
   
-  safe_free((void **)&((*args)->proc_mnt));
+  safe_free((void **)&((*args)->queries));
+  delete_filter(&((*args)->filter));
+  for (i = 0; i < (*args)->nroots; i++)
+    safe_free((void **)&((*args)->proc_mnt[i]));
   safe_free((void **)args);
 }
 
+/**
+ * @name insert_root - Append a procfs root.
+ * @param args: The arguments object.
+ * @param root: The path of the root.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int insert_root(callargs_t *args, const char *root) {
+  if (!args || !root || !(*root)) {
+    report_error("insert_root", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  if (args->nroots == ROOTMAX) {
+    fprintf(stderr, "nscat: At most %d procfs roots can be given.\n", ROOTMAX);
+    return RET_ERR_PARAM;
+  }
+  if (!(args->proc_mnt[args->nroots] = strdup(root))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  args->nroots++;
+  return RET_OK;
+}
+
+/**
+ * @name get_format_from_name - Convert an output format name to its code.
+ * @param name: The format name, e.g. "dot".
+ * @return The format code, or FORMAT_NONE if the name is unknown.
+ */
+unsigned short get_format_from_name(const char *name) {
+  unsigned short format;
+
+  if (!name)
+    return FORMAT_NONE;
+  for (format = 0; format < FORMAT_COUNT; format++)
+    if (!strcmp(name, formats[format]))
+      return format;
+  return FORMAT_NONE;
+}
+
+/**
+ * @name get_name_from_format - Convert an output format code to its name.
+ * @param format: The format code.
+ * @return The format name.
+ */
+const char *get_name_from_format(const unsigned short format) {
+  return format < FORMAT_COUNT ? formats[format] : "unknown";
+}
+
+/**
+ * @name get_ns_root - Get the root that identifies the namespaces of a root.
+ * @param root: The index of a procfs root.
+ * @return The root itself if the roots do not share a kernel, so that
+ *         their namespaces are kept apart, or ROOT_ANY otherwise.
+ */
+unsigned short get_ns_root(const unsigned short root) {
+  if (!info || !(info->args) || !(info->args->flags & FLAG_SPLITROOTS))
+    return ROOT_ANY;
+  return root;
+}
+
+/**
+ * @name insert_query - Append a namespace or process query.
+ * @param args: The arguments object.
+ * @param type: The query type (QUERY_NS, QUERY_PID or QUERY_NSPID).
+ * @param id: The namespace ID or the process ID to look for.
+ * @param nid: The PID namespace of a QUERY_NSPID query, 0 otherwise.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int insert_query(callargs_t *args, const unsigned short type,
+		 const unsigned long id, const ino_t nid) {
+  query_t *q;
+
+  if (!args) {
+    report_error("insert_query", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  if (!(q = realloc(args->queries, (args->nqueries + 1) * sizeof(query_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  q[args->nqueries].type = type;
+  q[args->nqueries].id = id;
+  q[args->nqueries].nid = nid;
+  args->queries = q;
+  args->nqueries++;
+  return RET_OK;
+}
+
 /**
  * @name clear_info - Clear the info object.
  * @return Void.
@@ -48,7 +165,12 @@ void clear_info() {
 	clear_namespace_tree(&(info->namespace[i]));
 
     // Clear processes.
+    clear_pid_index(&(info->pids));
     clear_process_list(&(info->process));
+    clear_cgroup_table(&(info->cgroups));
+    clear_ns_index(&(info->ns_index));
+    if (backend->release)
+      backend->release();
 
     // Clear arguments.
     clear_args(&(info->args));
@@ -59,68 +181,165 @@ void clear_info() {
 }
 
 /**
- * @name print_info - Print the collected information.
+ * @name print_ns_query - Print the answer to a namespace query.
+ * @param nid: The requested namespace ID.
  * @return Void.
  */
-void print_info() {
+static void print_ns_query(const ino_t nid) {
+  unsigned short type;
+  tree_t *nt = NULL;
+  char message[BUFFER_SIZE];
+
+  for (type = 0; type < NSCOUNT; type++)
+    if (info->namespace[type])
+      if ((nt = search_namespace_tree(info->namespace[type], ROOT_ANY, nid)))
+	break;
+  if (!nt) {
+    snprintf(message, sizeof(message), "No such namespace [%lu]", nid);
+    report_error(NULL, message, ERROR_MSG);
+    return;
+  }
+  print_namespace_info(nt->namespace, 0);
+}
+
+/**
+ * @name print_pid_query - Print the answer to a process query.
+ * @param pid: The requested process ID.
+ * @return Void.
+ */
+static void print_pid_query(const pid_t pid) {
   unsigned short type;
   process_t *p = NULL;
   tree_t *nt = NULL;
+  char message[BUFFER_SIZE];
 
-  if (!info || !(info->args))
+  if (!(p = search_process_list(info->process, pid))) {
+    snprintf(message, sizeof(message), "No such process <%d>", pid);
+    report_error(NULL, message, ERROR_MSG);
     return;
+  }
+  // Check if the user wants the process descendants.
+  if (info->args->flags & FLAG_DESCS) {
+    for (type = 0; type < NSCOUNT; type++) {
+      if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[type]))
+	continue;
 
-  // Check if a particular namespace ID was requested.
-  if (info->args->ns) {
-    for (type = 0; type < NSCOUNT; type++) 
-      if (info->namespace[type])
-	if (nt = search_namespace_tree(info->namespace[type], info->args->ns))
-	  break;
-    if (!nt) {      
-      report_error(NULL, "No such namespace", ERROR_MSG);
-      return;
+      if (!(info->namespace[type]) || !(p->namespace[type]))
+	continue;
+
+      if (!(nt = search_namespace_tree(info->namespace[type],
+					get_ns_root(p->root),
+					p->namespace[type]->nid)))
+	continue;
+
+      printf("Namespace: %s\n", get_name_from_type(type));
+      print_parented_namespaces(nt);
+      print_orphaned_namespaces(nt);
+      printf("\n");
+    }
+  } else {
+    for (type = 0; type < NSCOUNT; type++) {
+      if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[type]))
+	continue;
+
+      if (!(p->namespace[type]))
+	continue;
+
+      printf("Namespace: %s\n", get_name_from_type(type));
+      print_namespace_tree(p->namespace[type], 0);
+      printf("\n");
     }
-    print_namespace_info(nt->namespace, 0);
-    return;
   }
+}
+
+/**
+ * @name print_nspid_query - Print the answer to a namespace PID query.
+ * @param nid: The PID namespace.
+ * @param pid: The process ID inside the PID namespace.
+ * @return Void.
+ *
+ * The reverse index from namespace PIDs to processes is built on the
+ * first query and reused by the following ones.
+ */
+static void print_nspid_query(const ino_t nid, const pid_t pid) {
+  process_t *p;
+  char message[BUFFER_SIZE];
 
-  // Check if a particular process PID was requested.
-  if (info->args->pid) {
-    if (!(p = search_process_list(info->process, info->args->pid))) {        
-      report_error(NULL, "No such process", ERROR_MSG);
+  if (!info->pids)
+    if (build_pid_index(&(info->pids), info->process) != RET_OK)
       return;
-    }
-    // Check if the user wants the process descendants.
-    if (info->args->flags & FLAG_DESCS) {
-      for (type = 0; type < NSCOUNT; type++) {
-        if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[type]))
-          continue;
-
-        if (!(info->namespace[type]) || !(p->namespace[type]))
-          continue;
-        
-        if (!(nt = search_namespace_tree(info->namespace[type], p->namespace[type]->nid)))
-          continue;
-        
-        printf("Namespace: %s\n", get_name_from_type(type));
-        print_parented_namespaces(nt);
-        print_orphaned_namespaces(nt);
-        printf("\n");
-      }
-    } else {
-      for (type = 0; type < NSCOUNT; type++) {
-        if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[type]))
-          continue;
-
-        if (!(p->namespace[type]))
-          continue;
-        
-        printf("Namespace: %s\n", get_name_from_type(type));
-        print_namespace_tree(p->namespace[type], 0);
-        printf("\n");
+
+  if (!(p = search_pid_index(info->pids, nid, pid))) {
+    snprintf(message, sizeof(message), "No such process <%d> in namespace [%lu]",
+	     pid, nid);
+    report_error(NULL, message, ERROR_MSG);
+    return;
+  }
+  print_pid_query(p->pid);
+}
+
+/**
+ * @name print_info - Print the collected information.
+ * @return Void.
+ *
+ * All the -n and -p queries are answered from the same model. When more
+ * than one query was given, or the queries were read from the standard
+ * input, each answer is preceded by a tag line that names its query.
+ */
+void print_info() {
+  unsigned short type;
+  unsigned int i;
+  query_t *q;
+
+  if (!info || !(info->args))
+    return;
+
+  // The namespaces were printed as they were found. Print their final
+  // counters.
+  if (info->args->flags & FLAG_PROGRESS) {
+    for (type = 0; type < NSCOUNT; type++)
+      print_namespace_records(info->namespace[type], RECORD_UPDATE);
+    return;
+  }
+
+  // Print the namespace statistics as metrics.
+  if (info->args->format == FORMAT_OPENMETRICS) {
+    print_metrics();
+    return;
+  }
+
+  // Print only the namespace statistics.
+  if (info->args->flags & FLAG_STATS) {
+    print_all_stats();
+    return;
+  }
+
+  // Print the namespaces as a graph.
+  if (info->args->format != FORMAT_TREE) {
+    print_graph();
+    return;
+  }
+
+  // Answer the namespace and process queries.
+  if (info->args->nqueries) {
+    for (i = 0; i < info->args->nqueries; i++) {
+      q = &(info->args->queries[i]);
+      if ((info->args->flags & FLAG_BATCH) || info->args->nqueries > 1) {
+	if (q->type == QUERY_NSPID)
+	  printf("Query: nspid %lu %lu\n", q->nid, q->id);
+	else
+	  printf("Query: %s %lu\n", q->type == QUERY_PID ? "pid" : "ns", q->id);
       }
+      if (q->type == QUERY_PID)
+	print_pid_query((pid_t)q->id);
+      else if (q->type == QUERY_NSPID)
+	print_nspid_query(q->nid, (pid_t)q->id);
+      else
+	print_ns_query((ino_t)q->id);
+      if ((info->args->flags & FLAG_BATCH) || info->args->nqueries > 1)
+	printf("\n");
     }
-    return;    
+    return;
   }
 
   // The default case.
@@ -138,111 +357,432 @@ void print_info() {
 }
 
 /**
- * @name build_info - Collect namespace information.
+ * @name has_resolved_namespace - Check if the kernel resolved any parent.
+ * @param tree: Pointer to a namespace tree.
+ * @return 1 if a namespace of the tree has a kernel-provided parent,
+ *         0 otherwise.
+ */
+static int has_resolved_namespace(const tree_t *tree) {
+  for (; tree; tree = tree->sibling) {
+    if (tree->namespace && tree->namespace->resolved && tree->namespace->pnid)
+      return 1;
+    if (has_resolved_namespace(tree->child))
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * @name search_parent_process - Find the parent of a process.
+ * @param p: Pointer to the process.
+ * @return The parent process object or NULL.
+ *
+ * The parent PID is only meaningful under the procfs root the process
+ * was read from, so processes of other roots are skipped.
+ */
+static process_t *search_parent_process(const process_t *p) {
+  list_t *l;
+
+  for (l = info->process; l; l = l->next) {
+    PROFILE_COUNT(probes, 1);
+    if (l->process->pid == p->ppid && l->process->root == p->root)
+      return l->process;
+  }
+  return NULL;
+}
+
+/**
+ * @name link_processes - Link the processes and read their namespace IDs.
+ * @param nids: The address of an array that will hold the namespace
+ *              IDs of each process, in the order of the process list.
  * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Each process is linked with its parent, if it is still alive. The
+ * IDs of a process whose namespaces cannot be read are left 0, so that
+ * it joins no namespace. The IDs that a paced scan read during the walk
+ * are taken from the process instead.
  */
-int build_info() {
-  ino_t nid;
-  int status;
-  unsigned short type;
-  unsigned int size;
+static int link_processes(ino_t (**nids)[NSMAX]) {
+  char path[BUFFER_SIZE];
+  ino_t (*array)[NSMAX];
+  unsigned long i, size;
   list_t *l;
-  process_t *p;
-  namespace_t *ns;
-  char *path;
-  tree_t * ns_tree;
+  int status;
 
-  if (!info || !(info->args) || !(info->process)) {
-    report_error("build_info", debug_message(RET_ERR_PARAM), DEBUG_MSG);
-    return RET_ERR_PARAM;
+  size = count_process_list(info->process);
+  if (!(*nids = malloc(size * sizeof(**nids)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
   }
-  
-  // Sort the process list first.
-  sort_process_list(&(info->process));
 
-  // Traverse each process.
-  for (l = info->process; l; l = l->next) {
+  for (l = info->process, i = 0; l; l = l->next, i++) {
+    // The list grows while the threads are scanned.
+    if (i == size) {
+      size *= 2;
+      if (!(array = realloc(*nids, size * sizeof(**nids)))) {
+	report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+	return RET_ERR_NOMEM;
+      }
+      *nids = array;
+    }
+
     // Link with the parent (if it is still alive).
-    p = search_process_list(info->process, l->process->ppid);
-    l->process->parent = p;
-
-    // Get the process path on procfs.
-    size = strlen(info->args->proc_mnt) + 11;
-    if (!(path = malloc(size))) {
-      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG); 
-      return  RET_ERR_NOMEM;
+    l->process->parent = search_parent_process(l->process);
+
+    // A paced scan has read the IDs, and the threads, during the walk.
+    if (l->process->nids) {
+      memcpy((*nids)[i], l->process->nids, sizeof(**nids));
+      safe_free((void **)&(l->process->nids));
+      continue;
     }
-    memset(path, 0, size);    
-    snprintf(path, strlen(info->args->proc_mnt) + 10,
-	     "%s/%d\0", info->args->proc_mnt, l->process->pid);    
-    
-    // Process the  namespaces.
-    for (type = 0; type < NSCOUNT; type++) {      
-      if ((status = get_proc_namespace(path, type, &nid)) != RET_OK ) {
-	l->process->namespace[type] = NULL;
-	continue;
+
+    // Read all the namespace IDs of the process at once.
+    get_proc_path(l->process, path, sizeof(path));
+    if (get_proc_namespaces(path, (*nids)[i]) != RET_OK) {
+      memset((*nids)[i], 0, sizeof(**nids));
+      continue;
+    }
+
+    // Record the threads whose namespaces differ from the process. They
+    // are appended to the process list and linked later in this loop.
+    if ((info->args->flags & FLAG_THREADS) && l->process->threads > 1 &&
+	!l->process->tgid)
+      if ((status = scan_proc_threads(path, l->process, (*nids)[i])) == RET_ERR_NOMEM)
+	return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name build_namespace_type - Build the namespace tree of a type.
+ * @param type: The namespace type.
+ * @param nids: The namespace IDs of each process, in the order of the
+ *              process list.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Only info->namespace[type], the namespaces of that type and the
+ * namespace[type] slot of each process are written, so the trees of
+ * different types can be built at the same time.
+ */
+static int build_namespace_type(const unsigned short type, ino_t (*nids)[NSMAX]) {
+  char path[BUFFER_SIZE];
+  unsigned short relink = 0;
+  unsigned long i;
+  list_t *l;
+  process_t *p;
+  namespace_t *ns;
+  tree_t *ns_tree;
+  ino_t nid;
+  int status;
+
+  for (l = info->process, i = 0; l; l = l->next, i++) {
+    // Skip the namespace types that the filter excluded.
+    if (!(l->process->types & (1 << type)) || !(nid = nids[i][type])) {
+      l->process->namespace[type] = NULL;
+      continue;
+    }
+
+    // Search the namespace in the tree.
+    if ((ns_tree = search_namespace_tree(info->namespace[type],
+					 get_ns_root(l->process->root), nid))) {
+
+      // Found. Link it with the current process.
+      ns = ns_tree->namespace;
+      l->process->namespace[type] = ns;
+      if ((status = insert_process_list(&(ns->members), l->process)) != RET_OK)
+	return status;
+      ns->nmembers++;
+    } else {
+      // Not found. Build a new namespace entry.
+      if (!(ns = create_empty_namespace())) {
+	report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+	return RET_ERR_NOMEM;
       }
-      
-      // Search the namespace in the tree.
-      if ((ns_tree = search_namespace_tree(info->namespace[type], nid))) {
-	
-	// Found. Link it with the current process.
-	ns = ns_tree->namespace;	
-	l->process->namespace[type] = ns;
-	if ((status = insert_process_list(&(ns->members), l->process)) != RET_OK) {
-	  safe_free((void **)&path);
-	  return status;
-	}
-      } else {
-	// Not found. Build a new namespace entry.
-	if (!(ns = create_empty_namespace())) {
-	  report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG); 
-	  safe_free((void **)&path);
-	  return RET_ERR_NOMEM;
-	}
-	ns->nid = nid;
-	ns->type = type;
-	if (type == USER) {
-	  // It's a user namespace. We have to read the uid/gid map files.
-	  if ((status = get_proc_uid_map(path, ns->uid_map)) != RET_OK) {
-	    safe_free((void **)&path);
-	    delete_namespace(&ns);
-	    return status;
-	  }
-	  if ((status = get_proc_gid_map(path, ns->gid_map)) != RET_OK) {
-	    safe_free((void **)&path);
-	    delete_namespace(&ns);
-	    return status;
-	  }
-	}
-	ns->creator = l->process;
-	ns->creator_pid = l->process->pid;
-	if (p) {
-	  if (p->namespace[type]) {	      
+      ns->nid = nid;
+      ns->type = type;
+      ns->root = l->process->root;
+      ns->creator = l->process;
+      ns->creator_pid = l->process->pid;
+
+      // Ask the kernel for the parent and the owner of the namespace.
+      // If it cannot tell, guess the parent from the parent process.
+      get_proc_path(l->process, path, sizeof(path));
+      get_proc_ns_relatives(path, ns);
+      if (!ns->resolved) {
+	if ((p = l->process->parent)) {
+	  if (p->namespace[type]) {
 	    ns->pnid = p->namespace[type]->nid;
 	  }
 	} else {
 	  ns->pnid = 0;
 	}
+      }
+      if (ns->resolved)
+	relink = 1;
 
-	// Link the namespace with the current process.
-	l->process->namespace[type] = ns;
-	if ((status = insert_process_list(&(ns->members), l->process)) != RET_OK) {
-	  safe_free((void **)&path);
-	  delete_namespace(&ns);
-	  return status;
-	}
+      // Link the namespace with the current process.
+      l->process->namespace[type] = ns;
+      if ((status = insert_process_list(&(ns->members), l->process)) != RET_OK) {
+	delete_namespace(&ns);
+	return status;
+      }
+      ns->nmembers++;
+
+      //Add the new namespace to the tree.
+      if ((status = insert_namespace_tree(&(info->namespace[type]), ns))!= RET_OK) {
+	ns->members = NULL;
+	safe_free((void **)&ns);
+	return status;
+      }
+      if (info->args->flags & FLAG_PROGRESS)
+	print_namespace_record(ns, RECORD_NEW);
+
+      // The ID maps are shown with -e. Reading them here overlaps them
+      // with the trees of the other types.
+      if (type == USER && (info->args->flags & FLAG_EXTEND))
+	if (load_namespace_maps(ns) == RET_ERR_NOMEM)
+	  return RET_ERR_NOMEM;
+    }
+
+    // Roll the resource usage of the process up to its namespace.
+    if (info->args->flags & FLAG_ACCOUNT) {
+      ns->utime += l->process->utime;
+      ns->stime += l->process->stime;
+      ns->rss += l->process->rss;
+    }
+  }
+
+  // Namespaces with a kernel-provided parent may have been found before
+  // their parents. Rebuild the tree in parent order.
+  if (relink)
+    return relink_namespace_tree(&(info->namespace[type]));
+  return RET_OK;
+}
+
+/**
+ * @name build_worker - Build namespace trees until no type is left.
+ * @param arg: Pointer to the build pool.
+ * @return NULL.
+ */
+static void *build_worker(void *arg) {
+  build_pool_t *pool = arg;
+  unsigned short type;
+  int status;
 
-	//Add the new namespace to the tree.
-	if ((status = insert_namespace_tree(&(info->namespace[type]), ns))!= RET_OK) {
-	  safe_free((void **)&path);
-	  ns->members = NULL;
-	  safe_free((void **)&ns);
+  profile.phase = PHASE_BUILD;
+  for (;;) {
+    pthread_mutex_lock(&(pool->lock));
+    type = pool->next++;
+    pthread_mutex_unlock(&(pool->lock));
+    if (type >= NSCOUNT)
+      break;
+    if ((status = build_namespace_type(type, pool->nids)) != RET_OK) {
+      pthread_mutex_lock(&(pool->lock));
+      if (pool->status == RET_OK)
+	pool->status = status;
+      pthread_mutex_unlock(&(pool->lock));
+    }
+  }
+
+  // Hand the counters of this thread over to the main thread.
+  pthread_mutex_lock(&(pool->lock));
+  merge_profile(pool->profile);
+  pthread_mutex_unlock(&(pool->lock));
+  return NULL;
+}
+
+/**
+ * @name build_namespace_trees - Build the namespace trees of all types.
+ * @param nids: The namespace IDs of each process, in the order of the
+ *              process list.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The types are handed out to up to info->args->jobs threads. A thread
+ * that cannot be started leaves its share to the others; with one job,
+ * or with --progressive, whose records must not interleave, the trees
+ * are built in the calling thread.
+ */
+static int build_namespace_trees(ino_t (*nids)[NSMAX]) {
+  pthread_t threads[NSCOUNT];
+  build_pool_t pool;
+  unsigned int jobs, started = 0, i;
+  unsigned short type;
+  long cpus;
+  int status;
+
+  if (!(jobs = info->args->jobs))
+    jobs = (cpus = sysconf(_SC_NPROCESSORS_ONLN)) > 0 ? cpus : 1;
+  if (jobs > NSCOUNT)
+    jobs = NSCOUNT;
+  if (info->args->flags & FLAG_PROGRESS)
+    jobs = 1;
+
+  if (jobs == 1) {
+    for (type = 0; type < NSCOUNT; type++)
+      if ((status = build_namespace_type(type, nids)) != RET_OK)
+	return status;
+    return RET_OK;
+  }
+
+  pool.nids = nids;
+  pool.next = 0;
+  pool.status = RET_OK;
+  pool.profile = &profile;
+  pthread_mutex_init(&(pool.lock), NULL);
+  for (i = 0; i < jobs; i++)
+    if (!pthread_create(&threads[started], NULL, build_worker, &pool))
+      started++;
+  if (!started)
+    build_worker(&pool);
+  for (i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&(pool.lock));
+  return pool.status;
+}
+
+/**
+ * @name build_info - Collect namespace information.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The processes are linked first. The trees of the namespace types are
+ * then built independently of each other.
+ */
+int build_info() {
+  ino_t (*nids)[NSMAX] = NULL;
+  unsigned short type;
+  int status;
+
+  if (!info || !(info->args)) {
+    report_error("build_info", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  // In streaming mode the namespaces were built during the collection.
+  // Only the parent order of the trees is left to fix.
+  if (info->args->flags & FLAG_STREAM) {
+    for (type = 0; type < NSCOUNT; type++)
+      if (has_resolved_namespace(info->namespace[type]))
+	if ((status = relink_namespace_tree(&(info->namespace[type]))) != RET_OK)
 	  return status;
+    return RET_OK;
+  }
+
+  if (!(info->process)) {
+    report_error("build_info", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  
+  // Sort the process list first.
+  start_phase(PHASE_SORT);
+  sort_process_list(&(info->process));
+  start_phase(PHASE_BUILD);
+
+  if ((status = link_processes(&nids)) == RET_OK)
+    status = build_namespace_trees(nids);
+  safe_free((void **)&nids);
+  return status;
+}
+
+/**
+ * @name stream_process - Account a process to its namespaces and drop it.
+ * @param proc_path: The process path in procfs.
+ * @param p: The address of the process object. The object is released,
+ *           unless it is the first member of a namespace.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * This is the streaming counterpart of build_info(). The namespaces of
+ * the process are found through a hash index and only their counters
+ * are updated, so no member lists are kept. The first member of each
+ * namespace is kept as its creator, which bounds the number of live
+ * process objects by the number of namespaces. An unresolved parent is
+ * guessed from the namespaces of the parent process, which are read
+ * again from procfs since the parent itself is not kept.
+ */
+int stream_process(const char *proc_path, process_t **p) {
+  char parent_path[BUFFER_SIZE];
+  ino_t nid, nids[NSMAX], pnids[NSMAX];
+  unsigned short type, keep = 0, parent_read = 0;
+  namespace_t *ns, *pns;
+  int status = RET_OK;
+
+  if (!info || !(info->args) || !proc_path || !p || !(*p)) {
+    report_error("stream_process", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  if (get_proc_namespaces(proc_path, nids) != RET_OK) {
+    delete_process(p);
+    return RET_OK;
+  }
+
+  for (type = 0; type < NSCOUNT; type++) {
+    if (!((*p)->types & (1 << type)) || !(nid = nids[type]))
+      continue;
+
+    if (!(ns = search_ns_index(info->ns_index, type, nid))) {
+      // A new namespace. This process is its creator.
+      if (!(ns = create_empty_namespace())) {
+	status = RET_ERR_NOMEM;
+	break;
+      }
+      ns->nid = nid;
+      ns->type = type;
+      ns->root = (*p)->root;
+      ns->creator = *p;
+      ns->creator_pid = (*p)->pid;
+      get_proc_ns_relatives(proc_path, ns);
+      if (!ns->resolved && (*p)->ppid) {
+	if (!parent_read) {
+	  snprintf(parent_path, sizeof(parent_path), "%s/%d",
+		   info->args->proc_mnt[(*p)->root], (*p)->ppid);
+	  parent_read = get_proc_namespaces(parent_path, pnids) == RET_OK ? 1 : 2;
 	}
+	if (parent_read == 1 && (pns = search_ns_index(info->ns_index, type, pnids[type])))
+	  ns->pnid = pns->nid;
+      }
+      if ((status = insert_namespace_tree(&(info->namespace[type]), ns)) != RET_OK) {
+	delete_namespace(&ns);
+	break;
       }
+      if ((status = insert_ns_index(&(info->ns_index), ns)) != RET_OK)
+	break;
+      if (info->args->flags & FLAG_PROGRESS)
+	print_namespace_record(ns, RECORD_NEW);
+      keep = 1;
+    } else if (!ns->creator) {
+      // A namespace that --discover found first through a descriptor.
+      ns->creator = *p;
+      ns->creator_pid = (*p)->pid;
+      keep = 1;
+    }
+    (*p)->namespace[type] = ns;
+    ns->nmembers++;
+
+    // Roll the resource usage of the process up to its namespace.
+    if (info->args->flags & FLAG_ACCOUNT) {
+      ns->utime += (*p)->utime;
+      ns->stime += (*p)->stime;
+      ns->rss += (*p)->rss;
     }
-    safe_free((void **)&path);
   }
-  return RET_OK;
+
+  // Look for namespace descriptors before the process is dropped.
+  if (status == RET_OK && (info->args->flags & FLAG_DISCOVER))
+    if (scan_proc_fds(proc_path, *p) == RET_ERR_NOMEM)
+      status = RET_ERR_NOMEM;
+
+  if (keep) {
+    if (insert_process_list(&(info->process), *p) != RET_OK) {
+      // The namespaces still point to the process.
+      for (type = 0; type < NSCOUNT; type++)
+	if ((*p)->namespace[type] && (*p)->namespace[type]->creator == *p)
+	  (*p)->namespace[type]->creator = NULL;
+      delete_process(p);
+      return RET_ERR_NOMEM;
+    }
+    *p = NULL;
+  } else {
+    delete_process(p);
+  }
+  return status;
 }
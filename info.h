@@ -17,6 +17,7 @@
 
 #include <sys/types.h>
 #include <unistd.h>
+#include "filter.h"
 #include "namespace.h"
 #include "process.h"
 
@@ -25,30 +26,85 @@
 #define FLAG_DESCS   0x00000010
 #define FLAG_NSWANT  0x00000100
 #define FLAG_EXTEND  0x00001000
+#define FLAG_BATCH   0x00010000
+#define FLAG_STATS   0x00100000
+#define FLAG_ACCOUNT 0x01000000
+#define FLAG_DISCOVER 0x10000000
+#define FLAG_THREADS 0x0000000100000000ULL
+#define FLAG_CONTAINER 0x0000001000000000ULL
+#define FLAG_STREAM  0x0000010000000000ULL
+#define FLAG_PROGRESS 0x0000100000000000ULL
+#define FLAG_PROFILE 0x0001000000000000ULL
+#define FLAG_GENTLE  0x0010000000000000ULL
+#define FLAG_SPLITROOTS 0x0100000000000000ULL
+
+// Query types.
+#define QUERY_NS    0
+#define QUERY_PID   1
+#define QUERY_NSPID 2
+
+// Output formats.
+#define FORMAT_TREE    0
+#define FORMAT_DOT     1
+#define FORMAT_GRAPHML 2
+#define FORMAT_OPENMETRICS 3
+#define FORMAT_COUNT   4
+#define FORMAT_NONE    0xffff
 
 // Constant messages.
 static const char VERSION[] = "0.1";
 static const char PROCMNT[] = "/proc/";
 
+// Largest number of procfs roots given with -m.
+#define ROOTMAX 16
+
+// Matches the namespaces of any root.
+#define ROOT_ANY 0xffff
+
+// A single -n, -p or --ns-pid query.
+typedef struct query {
+  unsigned short type;
+  unsigned long id;
+  ino_t nid;
+} query_t;
+
 typedef struct callargs {
-  ino_t ns;
-  pid_t pid;
-  unsigned int flags;
-  unsigned short wanted[NSCOUNT];
-  char *proc_mnt;
+  unsigned long long flags;
+  unsigned int nqueries;
+  unsigned int top;
+  unsigned int jobs;
+  unsigned long rate;
+  double deadline;
+  double cpu_budget;
+  unsigned short format;
+  unsigned short wanted[NSMAX];
+  struct query *queries;
+  struct filter *filter;
+  char *proc_mnt[ROOTMAX];
+  unsigned short nroots;
 } callargs_t;
 
 typedef struct info {
   struct list *process;
-  struct tree *namespace[NSCOUNT];
+  struct pid_index *pids;
+  struct cgroup_table *cgroups;
+  struct ns_index *ns_index;
+  struct tree *namespace[NSMAX];
   struct callargs *args;
 } info_t;
 
 extern info_t *info;
 
 void clear_args(callargs_t **args);
+int insert_root(callargs_t *args, const char *root);
+unsigned short get_ns_root(const unsigned short root);
+unsigned short get_format_from_name(const char *name);
+const char *get_name_from_format(const unsigned short format);
+int insert_query(callargs_t *args, const unsigned short type,
+		 const unsigned long id, const ino_t nid);
 void clear_info();
 void print_info();
 int build_info();
+int stream_process(const char *proc_path, process_t **p);
 
 #endif
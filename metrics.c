@@ -0,0 +1,111 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#include <stdio.h>
+#include "common.h"
+#include "info.h"
+#include "metrics.h"
+#include "namespace.h"
+#include "profile.h"
+#include "stats.h"
+
+/*
+ * The metrics are printed in the OpenMetrics text format, e.g. for the
+ * textfile collector of the node exporter. They are computed from the
+ * namespace trees with the --stats code. The per-namespace series are
+ * limited to the --top largest namespaces of each type, so that the
+ * number of series does not grow with the number of containers. The
+ * heaps live on the stack, so printing the metrics allocates nothing.
+ */
+
+/**
+ * @name print_family - Print the metadata of a metric family.
+ * @param name: The metric name.
+ * @param help: The help text.
+ * @param unit: The unit, or NULL.
+ * @return Void.
+ */
+static void print_family(const char *name, const char *help, const char *unit) {
+  printf("# TYPE %s gauge\n", name);
+  if (unit)
+    printf("# UNIT %s %s\n", name, unit);
+  printf("# HELP %s %s\n", name, help);
+}
+
+/**
+ * @name print_metrics - Print the namespace metrics in OpenMetrics format.
+ * @return Void.
+ */
+void print_metrics() {
+  ns_count_t heaps[NSMAX][METRICS_TOPMAX];
+  stats_t st[NSMAX];
+  unsigned short wanted[NSMAX];
+  unsigned short type;
+  unsigned int top, i;
+  unsigned long long scan;
+  const namespace_t *ns;
+
+  if (!info || !(info->args))
+    return;
+
+  top = info->args->top < METRICS_TOPMAX ? info->args->top : METRICS_TOPMAX;
+  for (type = 0; type < NSCOUNT; type++) {
+    // Skip any namespaces that the user did not requested.
+    wanted[type] = !(info->args->flags & FLAG_NSWANT) || info->args->wanted[type];
+    if (wanted[type] &&
+	collect_stats(info->namespace[type], top, heaps[type], &st[type]) != RET_OK)
+      return;
+  }
+
+  print_family("nscat_namespaces", "Number of namespaces of each type.", NULL);
+  for (type = 0; type < NSCOUNT; type++)
+    if (wanted[type])
+      printf("nscat_namespaces{type=\"%s\"} %lu\n", get_name_from_type(type),
+	     st[type].namespaces);
+
+  print_family("nscat_orphaned_namespaces",
+	       "Number of namespaces of each type whose parent is unknown.", NULL);
+  for (type = 0; type < NSCOUNT; type++)
+    if (wanted[type])
+      printf("nscat_orphaned_namespaces{type=\"%s\"} %lu\n",
+	     get_name_from_type(type), st[type].orphans);
+
+  print_family("nscat_member_processes",
+	       "Number of member processes of the namespaces of each type.", NULL);
+  for (type = 0; type < NSCOUNT; type++)
+    if (wanted[type])
+      printf("nscat_member_processes{type=\"%s\"} %lu\n", get_name_from_type(type),
+	     st[type].members);
+
+  print_family("nscat_namespace_members",
+	       "Number of member processes of the largest namespaces of each type.",
+	       NULL);
+  for (type = 0; type < NSCOUNT; type++)
+    if (wanted[type])
+      for (i = 0; i < st[type].heap_size; i++) {
+	ns = st[type].heap[i].namespace;
+	printf("nscat_namespace_members{type=\"%s\",id=\"%lu\"",
+	       get_name_from_type(type), ns->nid);
+	if (info->args->flags & FLAG_SPLITROOTS)
+	  printf(",root=\"%hu\"", ns->root);
+	printf("} %lu\n", st[type].heap[i].members);
+      }
+
+  // The scan is over by now. Its phases were timed by the main thread.
+  scan = profile.wall[PHASE_COLLECT] + profile.wall[PHASE_SORT] +
+    profile.wall[PHASE_BUILD] + profile.wall[PHASE_DISCOVER];
+  print_family("nscat_scan_duration_seconds",
+	       "Wall clock time of the namespace scan.", "seconds");
+  printf("nscat_scan_duration_seconds %.6f\n", scan / 1e9);
+  printf("# EOF\n");
+}
@@ -0,0 +1,24 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_METRICS_H
+#define NSCAT_METRICS_H
+
+// Largest number of per-namespace series exported for each type. It
+// caps --top, which sets the number of series.
+#define METRICS_TOPMAX 100
+
+void print_metrics();
+
+#endif
@@ -11,21 +11,48 @@
  * Foundation.  See file LICENSE.
  *
  */
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <grp.h>
 #include <pwd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <sched.h>
 #include <unistd.h>
+#include "backend.h"
+#include "cgroup.h"
 #include "common.h"
+#include "discover.h"
 #include "info.h"
 #include "namespace.h"
 #include "process.h"
+#include "profile.h"
 #include <sys/ioctl.h>
 
+// The namespace type table. Types found at runtime are appended.
+ns_type_t ns_types[NSMAX] = {
+  {"CGROUP", "/ns/cgroup", 0},
+  {"IPC", "/ns/ipc", 0},
+  {"MNT", "/ns/mnt", 0},
+  {"NET", "/ns/net", 0},
+  {"PID", "/ns/pid", 0},
+  {"USER", "/ns/user", 0},
+  {"UTS", "/ns/uts", 0},
+  {"TIME", "/ns/time", 1},
+  {"PID_FOR_CHILDREN", "/ns/pid_for_children", 1},
+  {"TIME_FOR_CHILDREN", "/ns/time_for_children", 1}
+};
+unsigned short ns_type_count = 10;
+
 /**
  * @name create_empty_namespace - Create an empty namespace object.
  * @return Pointer to the new namespace object or NULL.
@@ -38,19 +65,22 @@ namespace_t *create_empty_namespace() {
     report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
     return NULL;
   }  
-  n->nid = n->pnid = 0;
+  n->nid = n->pnid = n->owner = 0;
   n->creator_pid = 0;
+  n->root = 0;
+  n->resolved = 0;
+  n->holder = NULL;
+  n->utime = n->stime = n->rss = 0;
   n->creator = NULL;
   n->members = NULL;
-  for (i = 0; i < MAP_LIMIT; i++) {
-    n->uid_map[i].uid_inside = 0;
-    n->uid_map[i].uid_inside = 0;
-    n->uid_map[i].uid_outside = 0;
-    n->uid_map[i].length = 0;
-    n->gid_map[i].gid_inside = 0;
-    n->gid_map[i].gid_outside = 0;
-    n->gid_map[i].length = 0;
-  }
+  n->nmembers = 0;
+  n->uid_map = NULL;
+  n->gid_map = NULL;
+  n->uid_map_count = n->gid_map_count = 0;
+  n->maps_read = 0;
+  n->details_read = 0;
+  n->mounts = n->interfaces = n->sockets = -1;
+  n->hostname = NULL;
   return n;
 }
 
@@ -75,6 +105,10 @@ void delete_namespace(namespace_t **ns) {
     safe_free((void **)&d);
   }
   (*ns)->members = NULL;
+  safe_free((void **)&((*ns)->holder));
+  safe_free((void **)&((*ns)->hostname));
+  safe_free((void **)&((*ns)->uid_map));
+  safe_free((void **)&((*ns)->gid_map));
   safe_free((void **)ns);
 }
 
@@ -116,10 +150,12 @@ unsigned long count_namespace_tree(tree_t *tree) {
 /**
  * @name search_namespace_tree - Search the tree for a namespace
  * @param tree: Pointer to a tree object.
+ * @param root: The procfs root of the namespace, or ROOT_ANY.
  * @param nid: Namespace ID.
  * @return A tree node or NULL.
  */
-tree_t *search_namespace_tree(tree_t *tree, const ino_t nid) {
+tree_t *search_namespace_tree(tree_t *tree, const unsigned short root,
+			      const ino_t nid) {
   tree_t *result = NULL;
   
   if (!tree) {
@@ -128,14 +164,16 @@ tree_t *search_namespace_tree(tree_t *tree, const ino_t nid) {
     return NULL;
   }
 
+  PROFILE_COUNT(probes, 1);
   if (tree->namespace) 
-    if (tree->namespace->nid == nid)
+    if (tree->namespace->nid == nid &&
+	(root == ROOT_ANY || tree->namespace->root == root))
       return tree;
 
-  if ((result = search_namespace_tree(tree->child, nid)))
+  if ((result = search_namespace_tree(tree->child, root, nid)))
     return result;
   
-  if ((result = search_namespace_tree(tree->sibling, nid)))
+  if ((result = search_namespace_tree(tree->sibling, root, nid)))
     return result;
 
   return NULL;
@@ -177,12 +215,19 @@ int insert_namespace_tree(tree_t **tree, namespace_t *ns) {
     return RET_OK;
   }
   // If the namespace is orphan then insert it directly under the root.
-  // Otherwise, insert it under its parent namespace.
-  if (is_orphaned_namespace(ns))
-    p = *tree;
-  else
-    if (!(p = search_namespace_tree(*tree, ns->pnid))) 
-      p = *tree;
+  // Otherwise, insert it under its parent namespace. The roots of the
+  // procfs roots that are kept apart are siblings.
+  if (is_orphaned_namespace(ns) ||
+      !(p = search_namespace_tree(*tree, get_ns_root(ns->root), ns->pnid)))
+    for (p = *tree; p && get_ns_root(ns->root) != ROOT_ANY; p = p->sibling)
+      if (p->namespace->root == ns->root)
+	break;
+  if (!p) {
+    c->depth = 0;
+    for (s = *tree; s->sibling; s = s->sibling);
+    s->sibling = c;
+    return RET_OK;
+  }
 
   c->depth = p->depth + 1;
   if (!(p->child)) {
@@ -202,6 +247,97 @@ int insert_namespace_tree(tree_t **tree, namespace_t *ns) {
   return RET_OK;
 }
 
+/**
+ * @name collect_namespace_nodes - Detach the namespaces of a tree.
+ * @param tree: Pointer to a namespace tree.
+ * @param array: Array where the namespaces will be placed.
+ * @param count: Pointer to the number of namespaces placed so far.
+ * @return Void.
+ *
+ * The tree nodes are freed. The namespace objects are kept.
+ */
+static void collect_namespace_nodes(tree_t *tree, namespace_t **array,
+				    unsigned long *count) {
+  tree_t *next;
+
+  while (tree) {
+    next = tree->sibling;
+    collect_namespace_nodes(tree->child, array, count);
+    if (tree->namespace)
+      array[(*count)++] = tree->namespace;
+    safe_free((void **)&tree);
+    tree = next;
+  }
+}
+
+/**
+ * @name relink_namespace_tree - Rebuild a tree from the namespace parents.
+ * @param tree: The address of a namespace tree.
+ * @return RET_OK on success or an error code in case of an error.
+ *
+ * Namespaces are inserted in the order their processes are found, so a
+ * namespace may be inserted before its parent. This method reinserts
+ * all the namespaces so that every parent precedes its children.
+ */
+int relink_namespace_tree(tree_t **tree) {
+  namespace_t **array;
+  unsigned short *done;
+  unsigned long count, found = 0, left, i, j, progress;
+  int status = RET_OK;
+
+  if (!tree || !(*tree))
+    return RET_OK;
+
+  count = count_namespace_tree(*tree);
+  if (!(array = malloc(count * sizeof(namespace_t *)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  if (!(done = calloc(count, sizeof(unsigned short)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    safe_free((void **)&array);
+    return RET_ERR_NOMEM;
+  }
+  collect_namespace_nodes(*tree, array, &found);
+  *tree = NULL;
+
+  // Insert the namespaces whose parent is unknown or already inserted,
+  // until no namespace is left. Each round inserts at least one level.
+  left = found;
+  do {
+    progress = 0;
+    for (i = 0; i < found; i++) {
+      if (done[i])
+	continue;
+      if (array[i]->pnid)
+	for (j = 0; j < found; j++)
+	  if (!done[j] && j != i && array[j]->nid == array[i]->pnid &&
+	      (get_ns_root(array[i]->root) == ROOT_ANY ||
+	       array[j]->root == array[i]->root))
+	    break;
+      if (array[i]->pnid && j < found)
+	continue;
+      if ((status = insert_namespace_tree(tree, array[i])) != RET_OK) {
+	safe_free((void **)&done);
+	safe_free((void **)&array);
+	return status;
+      }
+      done[i] = 1;
+      progress++;
+      left--;
+    }
+  } while (left && progress);
+
+  // Only a parent cycle can be left here. Insert it as it is.
+  for (i = 0; i < found; i++)
+    if (!done[i])
+      if ((status = insert_namespace_tree(tree, array[i])) != RET_OK)
+	break;
+  safe_free((void **)&done);
+  safe_free((void **)&array);
+  return status;
+}
+
 /**
  * @name print_width - Print spaces on the left of a sibling.
  * @return Void.
@@ -224,6 +360,38 @@ void print_branch(const unsigned int depth) {
     printf("     +");
 }
 
+/**
+ * @name format_member - Format a member process for printing.
+ * @param buffer: The buffer where the result will be placed.
+ * @param size: The size of the buffer.
+ * @param p: Pointer to the member process.
+ * @return The number of characters written.
+ *
+ * Processes are printed as "name <pid>" and divergent threads as
+ * "name <tgid/tid>". Processes in nested PID namespaces also get their
+ * innermost PID, e.g. "name <4242:1>". With several procfs roots the
+ * index of the root the process was read from follows, e.g.
+ * "name <4242>@1".
+ */
+static int format_member(char *buffer, const size_t size, const process_t *p) {
+  int length;
+
+  if (p->tgid) {
+    if (p->nslevels)
+      length = snprintf(buffer, size, "%s <%d/%d:%d>", p->name, p->tgid, p->pid,
+			p->nspid[p->nslevels - 1]);
+    else
+      length = snprintf(buffer, size, "%s <%d/%d>", p->name, p->tgid, p->pid);
+  } else if (p->nslevels)
+    length = snprintf(buffer, size, "%s <%d:%d>", p->name, p->pid,
+		      p->nspid[p->nslevels - 1]);
+  else
+    length = snprintf(buffer, size, "%s <%d>", p->name, p->pid);
+  if (info->args->nroots > 1 && length >= 0 && (size_t)length < size)
+    length += snprintf(buffer + length, size - length, "@%hu", p->root);
+  return length;
+}
+
 /**
  * @name print_namespace_info - Print extended namespace information.
  * @param ns: Pointer to a namespace.
@@ -244,7 +412,16 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
     "Member Processes",
     "UID Map",
     "GID Map",
-    "Member processes"
+    "Member processes",
+    "CPU user time",
+    "CPU system time",
+    "Resident memory",
+    "Held by",
+    "Containers",
+    "Mounts",
+    "Interfaces",
+    "Sockets",
+    "Hostname"
   };
   unsigned int current, width = 0;
   unsigned int max_width = strlen(titles[6]);
@@ -310,7 +487,7 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
   } else if (ns->creator_pid == 0) {
     printf("%s [%s]\n", "root", "0");
   } else {
-    printf("%s [%s]\n", "Unknown, Unknown");
+    printf("%s [%s]\n", "Unknown", "Unknown");
   }
 
   // Parent namespace ID
@@ -323,7 +500,9 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
   // Owner user namespace
   print_width(depth);    
   printf("%-*s: ", max_width, titles[6]);
-  if (ns->creator) 
+  if (ns->owner)
+    printf("%ld\n", ns->owner);
+  else if (ns->creator) 
     if (ns->creator->namespace[USER])
       printf("%ld\n", ns->creator->namespace[USER]->nid);
     else
@@ -341,11 +520,61 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
   
   // Member processes
   print_width(depth);    
-  printf("%-*s: %ld\n", max_width, titles[7],count_process_list(ns->members));
+  printf("%-*s: %ld\n", max_width, titles[7],ns->nmembers);
+
+  // Bind mount or file descriptor that keeps a process-less namespace
+  if (ns->holder) {
+    print_width(depth);
+    printf("%-*s: %s\n", max_width, titles[14], ns->holder);
+  }
+
+  // Type specific details. They are read on first use and cached.
+  if (ns->type == MNT || ns->type == NET || ns->type == UTS)
+    load_namespace_details((namespace_t *)ns);
+  if (ns->type == MNT && ns->mounts >= 0) {
+    print_width(depth);
+    printf("%-*s: %ld\n", max_width, titles[16], ns->mounts);
+  }
+  if (ns->type == NET && ns->interfaces >= 0) {
+    print_width(depth);
+    printf("%-*s: %ld\n", max_width, titles[17], ns->interfaces);
+  }
+  if (ns->type == NET && ns->sockets >= 0) {
+    print_width(depth);
+    printf("%-*s: %ld\n", max_width, titles[18], ns->sockets);
+  }
+  if (ns->type == UTS) {
+    print_width(depth);
+    printf("%-*s: %s\n", max_width, titles[19],
+	   ns->hostname ? ns->hostname : "Unknown");
+  }
+
+  // Containers of the member processes
+  if (info->args->flags & FLAG_CONTAINER) {
+    print_width(depth);
+    if (format_ns_containers(ns, printstr, sizeof(printstr)))
+      printf("%-*s: %s\n", max_width, titles[15], printstr);
+    else
+      printf("%-*s: %s\n", max_width, titles[15], "-");
+  }
+
+  // Resource usage of the member processes
+  if (info->args->flags & FLAG_ACCOUNT) {
+    print_width(depth);
+    printf("%-*s: %.2fs\n", max_width, titles[11],
+	   (double)ns->utime / sysconf(_SC_CLK_TCK));
+    print_width(depth);
+    printf("%-*s: %.2fs\n", max_width, titles[12],
+	   (double)ns->stime / sysconf(_SC_CLK_TCK));
+    print_width(depth);
+    printf("%-*s: %lu KiB\n", max_width, titles[13],
+	   ns->rss * (sysconf(_SC_PAGESIZE) / 1024));
+  }
   
-  // UID & GID Map
+  // UID & GID Map. They are read on first use and cached.
   if (ns->type == USER) {
-    for (j = 0; j < MAP_LIMIT; j++) {
+    load_namespace_maps((namespace_t *)ns);
+    for (j = 0; j < ns->uid_map_count; j++) {
       if (ns->uid_map[j].length > 0) {
 	width = max_width - strlen(titles[8]) - 1;
 	print_width(depth);    
@@ -354,7 +583,7 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
 	       ns->uid_map[j].length);
       }
     }
-    for (j = 0; j < MAP_LIMIT; j++) {
+    for (j = 0; j < ns->gid_map_count; j++) {
       if (ns->gid_map[j].length > 0) {
 	width = max_width - strlen(titles[9]) - 1;
 	print_width(depth);    
@@ -370,17 +599,18 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
   if ((info->args->flags & FLAG_PROCESS) && depth <= 0) {
     current = printf("%-*s: ", max_width, titles[10]);
     if (pl = ns->members) {      
-      current += printf("%s <%d>, ", pl->process->name, pl->process->pid);
+      format_member(printstr, 1024, pl->process);
+      current += printf("%s, ", printstr);
       pl = pl->next;
     }
     while (pl) {
       memset(printstr, 0, 1024);
-      snprintf(printstr, 1024, "%s <%d>, ", pl->process->name, pl->process->pid);
-      if (current + strlen(printstr) > w.ws_col) {	
+      format_member(printstr, 1024, pl->process);
+      if (current + strlen(printstr) + 2 > w.ws_col) {	
 	printf("\n");
 	current = printf("%-*s  ", max_width, "");
       }
-      current += printf("%s <%d>, ", pl->process->name, pl->process->pid);
+      current += printf("%s, ", printstr);
       pl = pl->next;
     }
     printf("\b\b \n");
@@ -396,6 +626,7 @@ void print_namespace_info(const namespace_t *ns, const unsigned int depth) {
 void print_namespace_tree(const namespace_t *ns, const unsigned int depth){
   unsigned int i, j, chars;
   list_t *pl;
+  char printstr[1024];
 
   if (!ns) {
     report_error("print_namespace_tree", debug_message(RET_ERR_PARAM),
@@ -403,9 +634,19 @@ void print_namespace_tree(const namespace_t *ns, const unsigned int depth){
     return;
   }
 
-  // Print namespace.
+  // Print namespace. Namespaces of roots that are kept apart are
+  // marked with their root.
   print_branch(depth);  
-  printf("-- [%s][%ld]\n", get_name_from_type(ns->type), ns->nid);
+  printf("-- [%s][%ld]", get_name_from_type(ns->type), ns->nid);
+  if (info->args->flags & FLAG_SPLITROOTS)
+    printf("@%hu", ns->root);
+  if (ns->holder)
+    printf(" (%s)\n", ns->holder);
+  else if ((info->args->flags & FLAG_CONTAINER) &&
+	   format_ns_containers(ns, printstr, sizeof(printstr)))
+    printf(" (%s)\n", printstr);
+  else
+    printf("\n");
   if (info->args->flags & FLAG_EXTEND)
     print_namespace_info(ns, depth + 1);
   
@@ -415,7 +656,8 @@ void print_namespace_tree(const namespace_t *ns, const unsigned int depth){
     printf("\n");
     for (pl = ns->members; pl; pl = pl->next) {  
       print_branch(depth+1);
-      printf("-- %s <%d>\n", pl->process->name, pl->process->pid);
+      format_member(printstr, sizeof(printstr), pl->process);
+      printf("-- %s\n", printstr);
     }
     print_width(depth+1);
     printf("\n");    
@@ -464,6 +706,67 @@ void print_orphaned_namespaces(const tree_t *tree) {
       }
 }
 
+/**
+ * @name print_namespace_record - Print a one-line --progressive record.
+ * @param ns: Pointer to a namespace.
+ * @param kind: RECORD_NEW when the namespace is first found, or
+ *              RECORD_UPDATE for its final counters.
+ * @return Void.
+ *
+ * Records are made of space separated key=value fields. The comm and
+ * holder fields can contain spaces, so they always come last and take
+ * the rest of the line. Each record is flushed, so that a reader of a
+ * pipe sees it immediately.
+ */
+void print_namespace_record(const namespace_t *ns, const unsigned short kind) {
+  if (!ns) {
+    report_error("print_namespace_record", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return;
+  }
+
+  // Skip any namespaces that the user did not requested.
+  if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[ns->type]))
+    return;
+
+  if (kind == RECORD_NEW) {
+    printf("new type=%s id=%lu parent=%lu", get_name_from_type(ns->type),
+	   ns->nid, ns->pnid);
+    if (info->args->nroots > 1)
+      printf(" root=%hu", ns->root);
+    if (ns->holder)
+      printf(" holder=%s\n", ns->holder);
+    else if (ns->creator)
+      printf(" creator=%d comm=%s\n", ns->creator->pid,
+	     ns->creator->name ? ns->creator->name : "");
+    else
+      printf("\n");
+  } else {
+    printf("update type=%s id=%lu parent=%lu members=%lu",
+	   get_name_from_type(ns->type), ns->nid, ns->pnid, ns->nmembers);
+    if (info->args->flags & FLAG_SPLITROOTS)
+      printf(" root=%hu", ns->root);
+    if (info->args->flags & FLAG_ACCOUNT)
+      printf(" utime=%lu stime=%lu rss_kib=%lu", ns->utime, ns->stime,
+	     ns->rss * (sysconf(_SC_PAGESIZE) / 1024));
+    printf("\n");
+  }
+  fflush(stdout);
+}
+
+/**
+ * @name print_namespace_records - Print a record for every namespace of a tree.
+ * @param tree: Pointer to a namespace tree.
+ * @param kind: The record kind.
+ * @return Void.
+ */
+void print_namespace_records(const tree_t *tree, const unsigned short kind) {
+  for (; tree; tree = tree->sibling) {
+    if (tree->namespace)
+      print_namespace_record(tree->namespace, kind);
+    print_namespace_records(tree->child, kind);
+  }
+}
+
 /**
  * @name is_orphaned_namespace - Check if a namespace is orphaned.
  * @param n: Pointer to a namespace object.
@@ -471,7 +774,7 @@ void print_orphaned_namespaces(const tree_t *tree) {
  */
 unsigned short is_orphaned_namespace(const namespace_t *n) {
   if (n) 
-    if (n->pnid || n->creator_pid == 1)
+    if (n->pnid || n->resolved || n->creator_pid == 1)
       return 0;
   return 1;
 }
@@ -482,24 +785,55 @@ unsigned short is_orphaned_namespace(const namespace_t *n) {
  * @return Namespace type string.
  */
 const char *get_name_from_type(const unsigned short type) {
-  switch (type) {
-    case IPC:
-      return "IPC";
-    case MNT:
-      return "MNT";
-    case NET:
-      return "NET";
-    case PID:
-      return "PID";      
-    case USER:
-      return "USER";      
-    case UTS:
-      return "UTS";
-    case CGROUP:
-      return "CGROUP";
-    default:
-      return "UNKNOWN";
+  if (type >= NSCOUNT)
+    return "UNKNOWN";
+  return ns_types[type].name;
+}
+
+/**
+ * @name get_type_from_name - Convert a namespace type string to a type.
+ * @param name: The namespace type string, in any case.
+ * @return The namespace type, or NSCOUNT if the name is not recognized.
+ */
+unsigned short get_type_from_name(const char *name) {
+  unsigned short type;
+
+  if (!name)
+    return NSCOUNT;
+
+  for (type = 0; type < NSCOUNT; type++)
+    if (!strcasecmp(name, get_name_from_type(type)))
+      return type;
+  return NSCOUNT;
+}
+
+/**
+ * @name register_ns_type - Add a namespace type to the type table.
+ * @param file: The name of the namespace file in the ns directory.
+ * @return The type of the namespace file, or NSCOUNT if the type is
+ *         new and the table is full.
+ */
+unsigned short register_ns_type(const char *file) {
+  unsigned short type, i;
+
+  if (!file || strlen(file) >= NSNAMELEN)
+    return NSCOUNT;
+
+  if ((type = get_type_from_name(file)) < NSCOUNT)
+    return type;
+  if (NSCOUNT >= NSMAX) {
+    report_error("register_ns_type", "Namespace type table is full", DEBUG_MSG);
+    return NSCOUNT;
   }
+  type = NSCOUNT;
+  for (i = 0; file[i]; i++)
+    ns_types[type].name[i] = toupper((unsigned char)file[i]);
+  ns_types[type].name[i] = 0;
+  snprintf(ns_types[type].file, sizeof(ns_types[type].file), "%s/%s",
+	   PROCNSDIR, file);
+  ns_types[type].optional = 1;
+  ns_type_count++;
+  return type;
 }
 
 /**
@@ -508,24 +842,43 @@ const char *get_name_from_type(const unsigned short type) {
  * @return Namespace file in string form.
  */
 char *get_namespace_file(const unsigned short type) {
-  switch (type) {
-    case IPC:
-      return "/ns/ipc";
-    case MNT:
-      return "/ns/mnt";
-    case NET:
-      return "/ns/net";
-    case PID:
-      return  "/ns/pid";
-    case USER:
-      return "/ns/user";
-    case UTS:
-      return "/ns/uts";
-    case CGROUP:
-      return "/ns/cgroup";
-    default:
-      return "";
+  if (type >= NSCOUNT)
+    return "";
+  return ns_types[type].file;
+}
+
+/**
+ * @name get_proc_ns_types - Register the namespace types of a process.
+ * @param proc_path: The process path in procfs.
+ * @param present: Pointer to a bitmask where the types found in the ns
+ *                 directory of the process will be placed.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int get_proc_ns_types(const char *proc_path, unsigned long *present) {
+  char target_path[BUFFER_SIZE];
+  struct dirent *entry;
+  unsigned short type;
+  DIR *dir;
+
+  if (!proc_path || !present) {
+    report_error("get_proc_ns_types", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCNSDIR);
+  PROFILE_COUNT(opens, 1);
+  if (!(dir = opendir(target_path))) {
+    report_error(target_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
   }
+  *present = 0;
+  while ((entry = readdir(dir))) {
+    if (entry->d_name[0] == '.')
+      continue;
+    if ((type = register_ns_type(entry->d_name)) < NSCOUNT)
+      *present |= 1UL << type;
+  }
+  closedir(dir);
+  return RET_OK;
 }
 
 /**
@@ -553,6 +906,7 @@ int get_proc_namespace(const char *proc_path, const unsigned short type, ino_t *
   }
   memset(target_path, 0, size+1);
   snprintf(target_path, BUFFER_SIZE, "%s%s\0", proc_path, ns_file);
+  PROFILE_COUNT(stats, 1);
   if (stat(target_path, &sb)) {
     report_error("get_proc_namespace", strerror(errno), DEBUG_MSG);
     safe_free((void **)&target_path); 
@@ -563,89 +917,533 @@ int get_proc_namespace(const char *proc_path, const unsigned short type, ino_t *
   return RET_OK;
 }
 
+/**
+ * @name get_proc_namespaces - Get the namespace IDs of a process.
+ * @param proc_path: The process path in procfs.
+ * @param nids: Array of NSMAX ino_t where the namespace ID of each type
+ *              will be placed, or 0 if the process has no such link.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The IDs are read through the backend. Types that are not in the type
+ * table are added to it.
+ */
+int get_proc_namespaces(const char *proc_path, ino_t *nids) {
+  if (!proc_path || !nids) {
+    report_error("get_proc_namespaces", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  return backend->get_namespaces(proc_path, nids);
+}
+
+/**
+ * @name get_ns_fd_inode - Get the namespace ID behind an nsfs ioctl.
+ * @param fd: An open namespace file.
+ * @param request: NS_GET_PARENT or NS_GET_USERNS.
+ * @param nid: Pointer to an ino_t where the result will be placed.
+ * @return RET_OK on success, RET_ERR_NOENTRY if the related namespace is
+ *         outside the caller's scope, or RET_ERR_NOLINK if the kernel or
+ *         the file does not support the request.
+ */
+static int get_ns_fd_inode(const int fd, const unsigned long request, ino_t *nid) {
+  struct stat sb;
+  int rfd;
+
+  if ((rfd = ioctl(fd, request)) < 0) {
+    if (errno == EPERM)
+      return RET_ERR_NOENTRY;
+    return RET_ERR_NOLINK;
+  }
+  if (fstat(rfd, &sb)) {
+    close(rfd);
+    return RET_ERR_NOLINK;
+  }
+  close(rfd);
+  *nid = sb.st_ino;
+  return RET_OK;
+}
+
+/**
+ * @name get_ns_relatives - Ask the kernel for the relatives of a namespace.
+ * @param ns_path: The path of a file that refers to the namespace.
+ * @param ns: Pointer to the namespace object whose nid and type are set.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * This method sets the owner user namespace of ns and, for the PID and
+ * USER namespaces, its parent namespace using the NS_GET_USERNS and
+ * NS_GET_PARENT ioctls. It is called once per namespace. On success, the
+ * namespace is marked as resolved, and its parent is authoritative. If
+ * the ioctls are not supported, e.g. when procfs is a copy, an error is
+ * returned and the caller has to guess the parent.
+ */
+int get_ns_relatives(const char *ns_path, namespace_t *ns) {
+  int fd, status;
+
+  if (!ns_path || !ns) {
+    report_error("get_ns_relatives", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  // Only the namespace files of the kernel answer the nsfs ioctls.
+  if (!backend->kernel)
+    return RET_ERR_NOENTRY;
+  PROFILE_COUNT(opens, 1);
+  if ((fd = open(ns_path, O_RDONLY|O_CLOEXEC)) < 0) {
+    report_error("get_ns_relatives", strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
+
+  // The owning user namespace. The initial user namespace has none.
+  if ((status = get_ns_fd_inode(fd, NS_GET_USERNS, &(ns->owner))) == RET_ERR_NOLINK) {
+    close(fd);
+    return status;
+  }
+
+  // The parent namespace. Only PID and USER namespaces are nested.
+  if (ns->type == PID || ns->type == USER) {
+    ns->pnid = 0;
+    if ((status = get_ns_fd_inode(fd, NS_GET_PARENT, &(ns->pnid))) == RET_ERR_NOLINK) {
+      close(fd);
+      return status;
+    }
+    ns->resolved = 1;
+  }
+  close(fd);
+  return RET_OK;
+}
+
+/**
+ * @name get_proc_ns_relatives - Ask the kernel for the relatives of a namespace.
+ * @param proc_path: The path in procfs of a member process.
+ * @param ns: Pointer to the namespace object whose nid and type are set.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int get_proc_ns_relatives(const char *proc_path, namespace_t *ns) {
+  char target_path[BUFFER_SIZE];
+
+  if (!proc_path || !ns) {
+    report_error("get_proc_ns_relatives", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path,
+	   get_namespace_file(ns->type));
+  return get_ns_relatives(target_path, ns);
+}
+
+/**
+ * @name read_map_file - Read and parse a uid_map or gid_map file.
+ * @param proc_path: The process path in procfs.
+ * @param file: PROCUIDMAPFILE or PROCGIDMAPFILE.
+ * @param extents: Array of MAP_LIMIT extents where the result will be placed.
+ * @param count: Pointer to the number of extents that were read.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The file is read whole into a stack buffer and each line is scanned
+ * for its three numbers without stdio. Malformed lines are skipped.
+ */
+static int read_map_file(const char *proc_path, const char *file,
+			 unsigned long extents[][3], unsigned int *count) {
+  char buffer[MAP_BUFFER_SIZE + 1];
+  unsigned long value = 0;
+  unsigned int field = 0;
+  unsigned short digits = 0;
+  size_t length = 0, i;
+  int status;
+
+  if ((status = backend->read_attr(proc_path, file, buffer, sizeof(buffer) - 1,
+				   &length)) != RET_OK)
+    return status;
+  buffer[length++] = '\n';
+
+  *count = 0;
+  for (i = 0; i < length && *count < MAP_LIMIT; i++) {
+    if (buffer[i] >= '0' && buffer[i] <= '9') {
+      value = value * 10 + (buffer[i] - '0');
+      digits = 1;
+      continue;
+    }
+    if (digits) {
+      if (field < 3)
+	extents[*count][field] = value;
+      field++;
+      value = 0;
+      digits = 0;
+    }
+    if (buffer[i] == '\n') {
+      if (field == 3)
+	(*count)++;
+      field = 0;
+    } else if (buffer[i] != ' ' && buffer[i] != '\t') {
+      // Not a number. Skip the rest of the line.
+      field = 4;
+    }
+  }
+  return RET_OK;
+}
+
 /**
  * @name get_proc_uid_map - Get the UID map of a process.
  * @param proc_path: The path in procfs to look for the namespace.
- * @param uid_map: Pointer to a uid_map_t where the result will be placed.
+ * @param uid_map: The address of a uid_map_t array that will be
+ *                 allocated to hold the extents.
+ * @param count: Pointer to the number of extents in the array.
  * @return RET_OK on success, or an error code in case of an error.
  */
-int get_proc_uid_map(const char *proc_path, uid_map_t *uid_map) {
-  char buffer[BUFFER_SIZE];
-  int ret, i;
-  char *target_path;
-  FILE *fd;
-  unsigned int size;
-  
-  if (!proc_path || !uid_map) {
+int get_proc_uid_map(const char *proc_path, uid_map_t **uid_map,
+		     unsigned int *count) {
+  unsigned long extents[MAP_LIMIT][3];
+  unsigned int i;
+  int status;
+
+  if (!proc_path || !uid_map || !count) {
     report_error("get_proc_uid_map", debug_message(RET_ERR_PARAM), DEBUG_MSG);
     return RET_ERR_PARAM;
   }
-  size = strlen(proc_path) + strlen(PROCUIDMAPFILE);
-  if (!(target_path = malloc(size+1))) {
+  if ((status = read_map_file(proc_path, PROCUIDMAPFILE, extents, count)) != RET_OK)
+    return status;
+  if (!(*count))
+    return RET_OK;
+  if (!(*uid_map = malloc(*count * sizeof(uid_map_t)))) {
     report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    *count = 0;
     return RET_ERR_NOMEM;
   }
-  memset(target_path, 0, size+1);
-  snprintf(target_path, BUFFER_SIZE, "%s%s\0", proc_path, PROCUIDMAPFILE);
-  if (!(fd = fopen(target_path, "r"))) {
-    report_error("get_proc_uid_map", strerror(errno), DEBUG_MSG);
-    safe_free((void **)&target_path); 
-    return RET_ERR_NOFILE;
+  for (i = 0; i < *count; i++) {
+    (*uid_map)[i].uid_inside = extents[i][0];
+    (*uid_map)[i].uid_outside = extents[i][1];
+    (*uid_map)[i].length = extents[i][2];
   }
-  safe_free((void **)&target_path); 
-  i = 0;
-  ret = fscanf(fd, "%ld%ld%ld\n",&(uid_map[i++].uid_inside),
-               &(uid_map[i++].uid_outside),
-               &(uid_map[i++].length));
-  while (ret != EOF && i < MAP_LIMIT)
-    ret = fscanf(fd, "%ld%ld%ld\n",&(uid_map[i++].uid_inside),
-		 &(uid_map[i++].uid_outside),
-		 &(uid_map[i++].length));
-  
-  fclose(fd);
   return RET_OK;
 }
 
 /**
  * @name get_proc_gid_map - Get the GID map of a process.
  * @param proc_path: The path in procfs to look for the namespace.
- * @param gid_map: Pointer to a gid_map_t where the result will be placed.
+ * @param gid_map: The address of a gid_map_t array that will be
+ *                 allocated to hold the extents.
+ * @param count: Pointer to the number of extents in the array.
  * @return RET_OK on success, or an error code in case of an error.
  */
-int get_proc_gid_map(const char *proc_path, gid_map_t *gid_map) {
-  char buffer[BUFFER_SIZE];
-  int ret, i;
-  char *target_path;
-  FILE *fd;
-  unsigned int size;
-  
-  if (!proc_path || !gid_map) {
+int get_proc_gid_map(const char *proc_path, gid_map_t **gid_map,
+		     unsigned int *count) {
+  unsigned long extents[MAP_LIMIT][3];
+  unsigned int i;
+  int status;
+
+  if (!proc_path || !gid_map || !count) {
     report_error("get_proc_gid_map", debug_message(RET_ERR_PARAM), DEBUG_MSG);
     return RET_ERR_PARAM;
   }
-  size = strlen(proc_path) + strlen(PROCGIDMAPFILE);
-  if (!(target_path = malloc(size+1))) {
+  if ((status = read_map_file(proc_path, PROCGIDMAPFILE, extents, count)) != RET_OK)
+    return status;
+  if (!(*count))
+    return RET_OK;
+  if (!(*gid_map = malloc(*count * sizeof(gid_map_t)))) {
     report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    *count = 0;
     return RET_ERR_NOMEM;
   }
-  memset(target_path, 0, size+1);
-  snprintf(target_path, BUFFER_SIZE, "%s%s\0", proc_path, PROCGIDMAPFILE);
-  if (!(fd = fopen(target_path, "r"))) {
-    report_error("get_proc_gid_map", strerror(errno), DEBUG_MSG);
-    safe_free((void **)&target_path); 
-    return RET_ERR_NOFILE;
+  for (i = 0; i < *count; i++) {
+    (*gid_map)[i].gid_inside = extents[i][0];
+    (*gid_map)[i].gid_outside = extents[i][1];
+    (*gid_map)[i].length = extents[i][2];
   }
-  safe_free((void **)&target_path); 
-  i = 0;
-  ret = fscanf(fd, "%d%d%d\n",&(gid_map[i++]).gid_inside,
-               &(gid_map[i++]).gid_outside,
-               &(gid_map[i++]).length);
-  while (ret != EOF && i < MAP_LIMIT)
-    ret = fscanf(fd, "%d%d%d\n",&(gid_map[i++]).gid_inside,
-		 &(gid_map[i++]).gid_outside,
-		 &(gid_map[i++]).length);
-  
+  return RET_OK;
+}
 
+/**
+ * @name load_namespace_maps - Read the UID and GID maps of a user namespace.
+ * @param ns: Pointer to the namespace object.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The maps are needed only for the extended output, so they are read
+ * from a member process the first time they are printed and then kept.
+ */
+int load_namespace_maps(namespace_t *ns) {
+  char proc_path[BUFFER_SIZE];
+  int status;
+
+  if (!ns || ns->type != USER) {
+    report_error("load_namespace_maps", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  if (ns->maps_read)
+    return RET_OK;
+  ns->maps_read = 1;
+  if (!ns->creator)
+    return RET_ERR_NOENTRY;
+
+  get_proc_path(ns->creator, proc_path, sizeof(proc_path));
+  if ((status = get_proc_uid_map(proc_path, &(ns->uid_map),
+				 &(ns->uid_map_count))) != RET_OK)
+    return status;
+  return get_proc_gid_map(proc_path, &(ns->gid_map), &(ns->gid_map_count));
+}
+
+/**
+ * @name count_file_lines - Count the lines of a file.
+ * @param path: The path of the file.
+ * @param skip: The number of header lines that are not counted.
+ * @return The number of lines, or -1 if the file cannot be read.
+ */
+static long count_file_lines(const char *path, const unsigned int skip) {
+  char buffer[BUFFER_SIZE];
+  size_t length;
+  long lines = 0;
+  FILE *fd;
+
+  PROFILE_COUNT(opens, 1);
+  if (!(fd = fopen(path, "r"))) {
+    report_error(path, strerror(errno), DEBUG_MSG);
+    return -1;
+  }
+  // Lines longer than the buffer are read in pieces; only the piece
+  // that ends in a newline is counted.
+  while (fgets(buffer, sizeof(buffer), fd)) {
+    length = strlen(buffer);
+    PROFILE_COUNT(bytes, length);
+    if (length && buffer[length - 1] == '\n')
+      lines++;
+  }
   fclose(fd);
+  return lines > skip ? lines - skip : 0;
+}
+
+/**
+ * @name get_proc_sockets - Get the number of sockets of a network namespace.
+ * @param proc_path: The path in procfs of a member process.
+ * @return The number of sockets in use, or -1 if it cannot be read.
+ */
+static long get_proc_sockets(const char *proc_path) {
+  char buffer[BUFFER_SIZE];
+  char target_path[BUFFER_SIZE];
+  long sockets = -1;
+  FILE *fd;
+
+  snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCSOCKSTATFILE);
+  PROFILE_COUNT(opens, 1);
+  if (!(fd = fopen(target_path, "r"))) {
+    report_error(target_path, strerror(errno), DEBUG_MSG);
+    return -1;
+  }
+  while (fgets(buffer, sizeof(buffer), fd))
+    if (sscanf(buffer, "sockets: used %ld", &sockets) == 1)
+      break;
+  fclose(fd);
+  return sockets;
+}
+
+/**
+ * @name get_proc_hostname - Get the hostname of a UTS namespace.
+ * @param proc_path: The path in procfs of a member process.
+ * @param hostname: The address of the string that will hold the hostname.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * procfs shows only the hostname of the reader's UTS namespace, so a
+ * short-lived child joins the namespace with setns(2) and reports the
+ * hostname through a pipe. This needs CAP_SYS_ADMIN. The hostname of
+ * the namespace nscat runs in is read directly.
+ */
+static int get_proc_hostname(const char *proc_path, char **hostname) {
+  char target_path[BUFFER_SIZE];
+  struct utsname name;
+  ino_t nid, self;
+  ssize_t length;
+  int fds[2], nsfd, wstatus;
+  pid_t child;
+
+  if (!backend->kernel)
+    return RET_ERR_NOENTRY;
+  snprintf(target_path, sizeof(target_path), "%s/self", info->args->proc_mnt[0]);
+  if (get_proc_namespace(proc_path, UTS, &nid) == RET_OK &&
+      get_proc_namespace(target_path, UTS, &self) == RET_OK && nid == self) {
+    if (uname(&name))
+      return RET_ERR_NOENTRY;
+  } else {
+    snprintf(target_path, sizeof(target_path), "%s%s", proc_path,
+	     get_namespace_file(UTS));
+    PROFILE_COUNT(opens, 1);
+    if ((nsfd = open(target_path, O_RDONLY | O_CLOEXEC)) < 0) {
+      report_error(target_path, strerror(errno), DEBUG_MSG);
+      return RET_ERR_NOFILE;
+    }
+    if (pipe(fds)) {
+      close(nsfd);
+      return RET_ERR_NOENTRY;
+    }
+    fflush(stdout);
+    if ((child = fork()) < 0) {
+      close(nsfd);
+      close(fds[0]);
+      close(fds[1]);
+      return RET_ERR_NOENTRY;
+    }
+    if (!child) {
+      close(fds[0]);
+      if (setns(nsfd, CLONE_NEWUTS) || uname(&name))
+	_exit(1);
+      length = write(fds[1], name.nodename, strlen(name.nodename));
+      _exit(length < 0);
+    }
+    close(nsfd);
+    close(fds[1]);
+    memset(name.nodename, 0, sizeof(name.nodename));
+    length = read(fds[0], name.nodename, sizeof(name.nodename) - 1);
+    close(fds[0]);
+    waitpid(child, &wstatus, 0);
+    if (length <= 0)
+      return RET_ERR_NOENTRY;
+  }
+  if (!(*hostname = strdup(name.nodename))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
   return RET_OK;
 }
+
+/**
+ * @name load_namespace_details - Read the type specific namespace details.
+ * @param ns: Pointer to the namespace object.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * The details are the mount count of a mount namespace, the interface
+ * and socket counts of a network namespace and the hostname of a UTS
+ * namespace. They are the same for every member, so they are read once
+ * from a single representative member and kept, which costs one read
+ * per namespace rather than one per process.
+ */
+int load_namespace_details(namespace_t *ns) {
+  char proc_path[BUFFER_SIZE];
+  char target_path[BUFFER_SIZE];
+
+  if (!ns) {
+    report_error("load_namespace_details", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  if (ns->details_read)
+    return RET_OK;
+  ns->details_read = 1;
+  if (!ns->creator)
+    return RET_ERR_NOENTRY;
+
+  get_proc_path(ns->creator, proc_path, sizeof(proc_path));
+  if (ns->type == MNT) {
+    snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCMOUNTINFOFILE);
+    ns->mounts = count_file_lines(target_path, 0);
+  } else if (ns->type == NET) {
+    // net/dev starts with two header lines.
+    snprintf(target_path, sizeof(target_path), "%s%s", proc_path, PROCNETDEVFILE);
+    ns->interfaces = count_file_lines(target_path, 2);
+    ns->sockets = get_proc_sockets(proc_path);
+  } else if (ns->type == UTS) {
+    return get_proc_hostname(proc_path, &(ns->hostname));
+  }
+  return RET_OK;
+}
+
+/**
+ * @name hash_ns_index - Hash a namespace type and ID.
+ */
+static unsigned long hash_ns_index(const unsigned short type, const ino_t nid,
+				   const unsigned long mask) {
+  unsigned long long h = ((unsigned long long)nid + type) * 0x9e3779b97f4a7c15ULL;
+
+  return (unsigned long)(h ^ (h >> 29)) & mask;
+}
+
+/**
+ * @name insert_ns_index - Add a namespace to a namespace index.
+ * @param index: The address of the index. It is created on first use.
+ * @param ns: Pointer to the namespace.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int insert_ns_index(ns_index_t **index, namespace_t *ns) {
+  namespace_t **table;
+  unsigned long i, slot, size;
+
+  if (!index || !ns) {
+    report_error("insert_ns_index", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  if (!(*index)) {
+    if (!(*index = malloc(sizeof(ns_index_t)))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      return RET_ERR_NOMEM;
+    }
+    if (!((*index)->table = calloc(NS_INDEX_SIZE, sizeof(namespace_t *)))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      safe_free((void **)index);
+      return RET_ERR_NOMEM;
+    }
+    (*index)->size = NS_INDEX_SIZE;
+    (*index)->count = 0;
+  }
+
+  // Keep the load factor under one half.
+  if (2 * ((*index)->count + 1) > (*index)->size) {
+    size = (*index)->size * 2;
+    if (!(table = calloc(size, sizeof(namespace_t *)))) {
+      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+      return RET_ERR_NOMEM;
+    }
+    for (i = 0; i < (*index)->size; i++) {
+      if (!(*index)->table[i])
+	continue;
+      slot = hash_ns_index((*index)->table[i]->type, (*index)->table[i]->nid,
+			   size - 1);
+      while (table[slot])
+	slot = (slot + 1) & (size - 1);
+      table[slot] = (*index)->table[i];
+    }
+    safe_free((void **)&((*index)->table));
+    (*index)->table = table;
+    (*index)->size = size;
+  }
+
+  slot = hash_ns_index(ns->type, ns->nid, (*index)->size - 1);
+  while ((*index)->table[slot]) {
+    if ((*index)->table[slot]->nid == ns->nid &&
+	(*index)->table[slot]->type == ns->type)
+      return RET_OK;
+    slot = (slot + 1) & ((*index)->size - 1);
+  }
+  (*index)->table[slot] = ns;
+  (*index)->count++;
+  return RET_OK;
+}
+
+/**
+ * @name search_ns_index - Find a namespace in a namespace index.
+ * @param index: Pointer to the index.
+ * @param type: The namespace type.
+ * @param nid: The namespace ID.
+ * @return Pointer to the namespace or NULL if it was not found.
+ */
+namespace_t *search_ns_index(const ns_index_t *index, const unsigned short type,
+			     const ino_t nid) {
+  unsigned long slot;
+
+  if (!index)
+    return NULL;
+  slot = hash_ns_index(type, nid, index->size - 1);
+  while (index->table[slot]) {
+    PROFILE_COUNT(probes, 1);
+    if (index->table[slot]->nid == nid && index->table[slot]->type == type)
+      return index->table[slot];
+    slot = (slot + 1) & (index->size - 1);
+  }
+  return NULL;
+}
+
+/**
+ * @name clear_ns_index - Release a namespace index.
+ * @param index: The address of the index.
+ * @return Void.
+ *
+ * The namespaces themselves belong to the namespace trees.
+ */
+void clear_ns_index(ns_index_t **index) {
+  if (!index || !(*index))
+    return;
+  safe_free((void **)&((*index)->table));
+  safe_free((void **)index);
+}
@@ -15,12 +15,16 @@
 #ifndef NSCAT_NAMESPACE_H
 #define NSCAT_NAMESPACE_H
 
+#include <sys/ioctl.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include "process.h"
 
-// Namespaces. 
-#define NSCOUNT 7
+// Namespaces. The well-known types have fixed indexes. Types that are
+// found in the ns directory of a process at runtime are appended to the
+// type table, up to NSMAX types in total.
+#define NSMAX   16
+#define NSCOUNT ns_type_count
 #define CGROUP  0
 #define IPC     1
 #define MNT     2
@@ -28,14 +32,48 @@
 #define PID     4
 #define USER    5
 #define UTS     6
+#define TIME    7
 
-// uid_map / gid_map limit.
-#define MAP_LIMIT 5
+// Maximum length of a namespace file name.
+#define NSNAMELEN 32
+
+// The ns directory under procfs.
+static const char PROCNSDIR[] = "/ns";
+
+// An entry of the namespace type table.
+typedef struct ns_type {
+  char name[NSNAMELEN];
+  char file[NSNAMELEN + 4];
+  unsigned short optional;
+} ns_type_t;
+
+extern ns_type_t ns_types[NSMAX];
+extern unsigned short ns_type_count;
+
+// nsfs ioctls (linux/nsfs.h), for systems whose headers lack them.
+#ifndef NSIO
+#define NSIO 0xb7
+#endif
+#ifndef NS_GET_USERNS
+#define NS_GET_USERNS _IO(NSIO, 0x1)
+#endif
+#ifndef NS_GET_PARENT
+#define NS_GET_PARENT _IO(NSIO, 0x2)
+#endif
+
+// uid_map / gid_map limit. This is the maximum number of extents the
+// kernel accepts, and each line is at most three 10-digit numbers.
+#define MAP_LIMIT       340
+#define MAP_BUFFER_SIZE (MAP_LIMIT * 33 + 1)
 
 // uid_map / gid_map files.
 static const char PROCUIDMAPFILE[] = "/uid_map";
 static const char PROCGIDMAPFILE[] = "/gid_map";
 
+// Network device and socket statistics under procfs.
+static const char PROCNETDEVFILE[] = "/net/dev";
+static const char PROCSOCKSTATFILE[] = "/net/sockstat";
+
 typedef  struct uid_map {
   uid_t uid_inside;
   uid_t uid_outside;
@@ -49,16 +87,48 @@ typedef struct gid_map {
 } gid_map_t;
 
 typedef struct namespace {
-  struct uid_map uid_map[MAP_LIMIT];
-  struct gid_map gid_map[MAP_LIMIT];
+  struct uid_map *uid_map;
+  struct gid_map *gid_map;
+  unsigned int uid_map_count;
+  unsigned int gid_map_count;
+  unsigned short maps_read;
+  unsigned short details_read;
+  long mounts;
+  long interfaces;
+  long sockets;
+  char *hostname;
   ino_t nid;
   ino_t pnid;
+  ino_t owner;
   pid_t creator_pid;
+  unsigned short resolved;
+  char *holder;
   unsigned short type;
+  unsigned short root;
+  unsigned long utime;
+  unsigned long stime;
+  unsigned long rss;
+  unsigned long nmembers;
   struct process *creator;
   struct list *members;
 } namespace_t;
 
+// Kinds of --progressive records.
+#define RECORD_NEW    0
+#define RECORD_UPDATE 1
+
+// Hash index from namespace types and IDs to namespaces. The type is
+// part of the key because pid_for_children and time_for_children share
+// the IDs of pid and time.
+typedef struct ns_index {
+  struct namespace **table;
+  unsigned long size;
+  unsigned long count;
+} ns_index_t;
+
+// Initial number of slots of a namespace index (a power of two).
+#define NS_INDEX_SIZE 64
+
 typedef struct tree {
   struct namespace *namespace;
   unsigned int depth;  
@@ -69,17 +139,35 @@ namespace_t *create_empty_namespace();
 void delete_namespace(namespace_t **ns);
 unsigned short is_orphaned_namespace(const namespace_t *n);
 const char *get_name_from_type(const unsigned short type);
+unsigned short get_type_from_name(const char *name);
+unsigned short register_ns_type(const char *file);
 char *get_namespace_file(const unsigned short type);
+int get_proc_ns_types(const char *proc_path, unsigned long *present);
 int get_proc_namespace(const char *proc_path, const unsigned short type, ino_t *ns);
-int get_proc_uid_map(const char *proc_path, uid_map_t *uid_map);
-int get_proc_gid_map(const char *proc_path, gid_map_t *gid_map);
+int get_proc_namespaces(const char *proc_path, ino_t *nids);
+int get_ns_relatives(const char *ns_path, namespace_t *ns);
+int get_proc_ns_relatives(const char *proc_path, namespace_t *ns);
+int get_proc_uid_map(const char *proc_path, uid_map_t **uid_map,
+		     unsigned int *count);
+int get_proc_gid_map(const char *proc_path, gid_map_t **gid_map,
+		     unsigned int *count);
+int load_namespace_maps(namespace_t *ns);
+int load_namespace_details(namespace_t *ns);
+int insert_ns_index(ns_index_t **index, namespace_t *ns);
+namespace_t *search_ns_index(const ns_index_t *index, const unsigned short type,
+			     const ino_t nid);
+void clear_ns_index(ns_index_t **index);
 unsigned long count_namespace_tree(tree_t *tree);
-tree_t *search_namespace_tree(tree_t *tree, const ino_t nid);
+tree_t *search_namespace_tree(tree_t *tree, const unsigned short root,
+			      const ino_t nid);
 int insert_namespace_tree(tree_t **tree, namespace_t *ns);
+int relink_namespace_tree(tree_t **tree);
 void print_namespace_info(const namespace_t *ns, unsigned int depth);
 void print_namespace_tree(const namespace_t *ns, const unsigned int depth);
 void print_parented_namespaces(const tree_t *tree);
 void print_orphaned_namespaces(const tree_t *tree);
+void print_namespace_record(const namespace_t *ns, const unsigned short kind);
+void print_namespace_records(const tree_t *tree, const unsigned short kind);
 void clear_namespace_tree(tree_t **tree);
 
 #endif  
@@ -20,10 +20,17 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include "backend.h"
 #include "common.h"
+#include "discover.h"
+#include "filter.h"
+#include "gentle.h"
+#include "graph.h"
 #include "info.h"
 #include "namespace.h"
 #include "process.h"
+#include "profile.h"
+#include "stats.h"
 
 /**
  * @name print_usage - Print usage information and exit.
@@ -37,13 +44,91 @@ void print_usage(const unsigned short is_error) {
       "   -t, --ns-type NS[,NS]...    Print information about the given\n"
       "                               namespaces only. The NS parameter\n"
       "                               can be one of: IPC, MNT, NET, PID,\n"
-      "                               USER, UTS, CGROUP. The default is to\n"
-      "                               print information about all namespaces.\n"
-      "   -n, --ns NID                Print information only for the given\n"
-      "                               namespace whose identifier matches NID.\n"
-      "   -p, --pid PID               Print namespace information only\n"
-      "                               for the process whose process ID\n"
-      "                               matches PID.\n"
+      "                               USER, UTS, CGROUP, TIME,\n"
+      "                               PID_FOR_CHILDREN, TIME_FOR_CHILDREN,\n"
+      "                               or any other file of /proc/PID/ns.\n"
+      "                               The default is to print information\n"
+      "                               about all namespaces.\n"
+      "   -n, --ns NID[,NID]...       Print information only for the given\n"
+      "                               namespaces whose identifiers match NID.\n"
+      "   -p, --pid PID[,PID]...      Print namespace information only\n"
+      "                               for the processes whose process IDs\n"
+      "                               match PID.\n"
+      "       --stdin                 Read further queries from the standard\n"
+      "                               input, one per line, in the form\n"
+      "                               'pid PID', 'ns NID' or 'nspid NID PID'.\n"
+      "                               All queries are answered from a single\n"
+      "                               scan.\n"
+      "       --ns-pid NID:PID[,...]  Print namespace information for the\n"
+      "                               process whose ID inside the PID\n"
+      "                               namespace NID is PID.\n"
+      "       --filter EXPR           Consider only the processes, and the\n"
+      "                               namespace types, for which EXPR holds,\n"
+      "                               e.g. 'comm=~nginx && uid>=1000 &&\n"
+      "                               type in (NET,PID)'. Fields: pid, ppid,\n"
+      "                               uid, gid, comm, type.\n"
+      "       --stats                 Print namespace statistics instead of\n"
+      "                               the namespace trees: counts, orphans,\n"
+      "                               member histogram, depth distribution\n"
+      "                               and the largest namespaces per type.\n"
+      "       --top N                 Like --stats, listing the N largest\n"
+      "                               namespaces of each type (default 10).\n"
+      "   -a, --accounting            Sum the CPU time and resident memory\n"
+      "                               of the member processes of each\n"
+      "                               namespace. Shown with --extend-info.\n"
+      "       --discover              Also find the namespaces that have no\n"
+      "                               processes but are kept alive by an nsfs\n"
+      "                               bind mount or an open file descriptor.\n"
+      "       --threads               Also scan the threads of multi-threaded\n"
+      "                               processes and show the threads whose\n"
+      "                               namespaces differ from their process.\n"
+      "       --stream                Build the namespace summary while the\n"
+      "                               processes are scanned and drop each\n"
+      "                               process right away. Memory then depends\n"
+      "                               on the number of namespaces only. Cannot\n"
+      "                               be combined with -r, -d, -p, --ns-pid,\n"
+      "                               --threads or --containers.\n"
+      "       --progressive           Print a record for each namespace as\n"
+      "                               soon as it is found, and its member\n"
+      "                               count once the scan is over. Best used\n"
+      "                               with --stream.\n"
+      "       --backend NAME          Read the process information through\n"
+      "                               the given backend: procfs (default),\n"
+      "                               dir, for a copy of procfs given with\n"
+      "                               -m, memory, which loads such a copy\n"
+      "                               in memory before the scan, or bpf,\n"
+      "                               which reads the processes through a\n"
+      "                               BPF task iterator (root only; falls\n"
+      "                               back to procfs).\n"
+      "       --profile               Print the wall and CPU time of each\n"
+      "                               phase of the run, and the number of\n"
+      "                               files opened, bytes read, stat calls\n"
+      "                               and lookup probes, on the standard\n"
+      "                               error.\n"
+      "       --jobs N                Build the trees of up to N namespace\n"
+      "                               types at the same time. The default\n"
+      "                               is the number of online CPUs.\n"
+      "       --gentle[=RATE]         Scan with the idle CPU and I/O\n"
+      "                               priorities, in small batches with a\n"
+      "                               yield in between, and at most RATE\n"
+      "                               processes per second if given.\n"
+      "       --deadline SEC          Stop the scan after SEC seconds and\n"
+      "                               print what was found so far.\n"
+      "       --cpu-budget SEC        Stop the scan after SEC seconds of\n"
+      "                               CPU time and print what was found so\n"
+      "                               far.\n"
+      "       --format FMT            Print the namespaces as an indented\n"
+      "                               tree (default), or as a graph in the\n"
+      "                               dot or graphml format, with the parent\n"
+      "                               and owner edges of the namespaces and,\n"
+      "                               with -r, the processes and their\n"
+      "                               membership edges, or as openmetrics,\n"
+      "                               the --stats counts in the OpenMetrics\n"
+      "                               text format.\n"
+      "       --containers            Label each namespace with the containers\n"
+      "                               of its members, as found in their cgroup\n"
+      "                               paths (docker, containerd, cri-o, podman\n"
+      "                               and systemd-machined).\n"
       "   -d, --descendants           This option can be used in conjuction\n"
       "                               with the --pid flag. It instructs the\n"
       "                               tool to print namespace information for\n"
@@ -52,6 +137,11 @@ void print_usage(const unsigned short is_error) {
       "                               all the process members of each namespace.\n"
       "   -e, --extend-info           Print extended information for each\n"
       "                               namespace.\n"
+      "   -m, --proc-mnt DIR[,...]    Read the processes from the procfs\n"
+      "                               mounted at DIR (default /proc). With\n"
+      "                               several roots, or several -m, they are\n"
+      "                               scanned in parallel and each member is\n"
+      "                               marked with the index of its root.\n"
       "   -h, --help                  Print this help message and exit.\n"
       "   -v, --version               Print the version number and exit.\n";
   
@@ -68,6 +158,95 @@ void print_version() {
   exit(EXIT_SUCCESS);
 }
 
+/**
+ * @name parse_query_list - Parse a comma separated list of IDs.
+ * @param type: The query type (QUERY_NS, QUERY_PID or QUERY_NSPID).
+ * @param list: The list in string form. The items of a QUERY_NSPID
+ *              list have the form NID:PID.
+ * @return RET_OK on success, an error code in case of an error.
+ */
+int parse_query_list(const unsigned short type, char *list) {
+  const char delim[2] = ",";
+  char *token, *end;
+  unsigned long id, nid = 0;
+  int status;
+
+  if (!list) {
+    report_error("parse_query_list", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  for (token = strtok(list, delim); token; token = strtok(NULL, delim)) {
+    end = token;
+    if (type == QUERY_NSPID) {
+      nid = strtoul(token, &end, 10);
+      if (end == token || *end != ':' || nid == 0) {
+	fprintf(stderr, "nscat: Invalid namespace PID '%s'.\n", token);
+	return RET_ERR_PARAM;
+      }
+      end++;
+    }
+    id = strtoul(end, &end, 10);
+    if (*end != 0 || id == 0) {
+      fprintf(stderr, "nscat: Invalid %s '%s'.\n",
+	      type == QUERY_NS ? "namespace ID" : "process ID", token);
+      return RET_ERR_PARAM;
+    }
+    if ((status = insert_query(info->args, type, id, nid)) != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name read_queries - Read queries from a stream.
+ * @param fd: The stream to read from.
+ * @return RET_OK on success, an error code in case of an error.
+ *
+ * Each line holds one query in the form "pid PID", "ns NID" or
+ * "nspid NID PID". Empty lines and lines starting with '#' are ignored.
+ */
+int read_queries(FILE *fd) {
+  char buffer[BUFFER_SIZE];
+  char kind[BUFFER_SIZE];
+  unsigned long id, nid;
+  unsigned int line = 0;
+  int status;
+
+  if (!fd) {
+    report_error("read_queries", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  while (fgets(buffer, sizeof(buffer), fd)) {
+    line++;
+    if (sscanf(buffer, "%1023s", kind) != 1 || kind[0] == '#')
+      continue;
+    if (sscanf(buffer, "%*s %lu", &id) != 1 || id == 0) {
+      fprintf(stderr, "nscat: Invalid query on line %u.\n", line);
+      return RET_ERR_PARAM;
+    }
+    if (!strcmp(kind, "pid"))
+      status = insert_query(info->args, QUERY_PID, id, 0);
+    else if (!strcmp(kind, "ns"))
+      status = insert_query(info->args, QUERY_NS, id, 0);
+    else if (!strcmp(kind, "nspid")) {
+      nid = id;
+      if (sscanf(buffer, "%*s %*s %lu", &id) != 1 || id == 0) {
+	fprintf(stderr, "nscat: Invalid query on line %u.\n", line);
+	return RET_ERR_PARAM;
+      }
+      status = insert_query(info->args, QUERY_NSPID, id, nid);
+    } else {
+      fprintf(stderr, "nscat: Unrecognized query '%s' on line %u.\n", kind, line);
+      return RET_ERR_PARAM;
+    }
+    if (status != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
 /**
  * @name check_environment - Check the environment.
  * @return RET_OK on success, an error code in case of an error.
@@ -78,47 +257,49 @@ void print_version() {
  * requested namespaces. unsupported namespaces are disabled.
  */
 int check_environment() {
-  char *path;
-  unsigned int size;
-  unsigned short type;
+  char path[BUFFER_SIZE];
+  unsigned long present;
+  unsigned short type, i;
 
-  if (!info || !(info->args) || !(info->args->proc_mnt)) {
+  if (!info || !(info->args) || !(info->args->nroots)) {
     report_error("check_environment", debug_message(RET_ERR_PARAM), DEBUG_MSG);
     return RET_ERR_PARAM;
   }
   
-  // Check the procfs mount point.
-  if (access(info->args->proc_mnt, F_OK|R_OK)) {
-    report_error(NULL, "The procfs mountpoint is not accessible", ERROR_MSG);
-    return RET_ERR_NOFILE;
-  }
+  // Check the procfs mount points.
+  for (i = 0; i < info->args->nroots; i++)
+    if (access(info->args->proc_mnt[i], F_OK|R_OK)) {
+      fprintf(stderr, "nscat: The procfs mountpoint %s is not accessible.\n",
+	      info->args->proc_mnt[i]);
+      return RET_ERR_NOFILE;
+    }
 
   // Check the user ID.
   if (getuid())
     warn_permissions();
   
-  // Check the system namespaces.
+  // Register the namespace types of the running kernel and check that
+  // the well-known ones are supported. If the ns directory cannot be
+  // read, e.g. in a copy of procfs, all the types are assumed to exist.
+  snprintf(path, sizeof(path), "%s/self", info->args->proc_mnt[0]);
+  if (get_proc_ns_types(path, &present) != RET_OK)
+    return RET_OK;
   for (type = 0; type < NSCOUNT; type++) {
     // Skip any namespaces that the user did not requested.
     if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[type]))
       continue;
 
-    size = strlen(info->args->proc_mnt) + 64;
-    if (!(path = malloc(size+1))) {
-      report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
-      return RET_ERR_NOMEM;
-    }
-    memset(path, 0, size+1);
-    snprintf(path, size, "%s/%d/%s\0", info->args->proc_mnt, getpid(),
-	     get_namespace_file(type));
-    if (access(path, F_OK|R_OK)) {
-      fprintf(stderr, "nsinfo: Warning - Your system does not support %s namespace.\n",
-	      get_name_from_type(type));
+    if (!(present & (1UL << type))) {
+      if (!ns_types[type].optional)
+	fprintf(stderr, "nscat: Warning - Your system does not support %s namespace.\n",
+		get_name_from_type(type));
       // disable this namespace.
+      if (!(info->args->flags & FLAG_NSWANT))
+	for (i = 0; i < NSMAX; i++)
+	  info->args->wanted[i] = 1;
       info->args->flags |= FLAG_NSWANT;
       info->args->wanted[type] = 0;
     }
-    safe_free((void **)&path);    
   }
   return RET_OK;
 }
@@ -131,10 +312,12 @@ int check_environment() {
  */
 int init(const int argc, char *argv[]) {
   int next_option;
-  unsigned int ns;
-  const char *short_options = "hvt:n:p:drm:e";
+  unsigned int ns, i;
+  unsigned short type;
+  const char *short_options = "hvt:n:p:adrm:e";
+  unsigned short from_stdin = 0, mounts = 0;
   const char delim[2] = ",";
-  char *token;
+  char *token, *end;
   
   const struct option long_options[] = {
     {"help",        0, NULL, 'h'},
@@ -142,10 +325,29 @@ int init(const int argc, char *argv[]) {
     {"ns-type",     1, NULL, 't'},
     {"ns",          1, NULL, 'n'},
     {"pid",         1, NULL, 'p'},
+    {"accounting",  0, NULL, 'a'},
     {"descendants", 0, NULL, 'd'},    
     {"show-procs",  0, NULL, 'r'},
     {"proc-mnt",    1, NULL, 'm'},
-    {"extend-info", 0, NULL, 'e'}
+    {"extend-info", 0, NULL, 'e'},
+    {"stdin",       0, NULL, 'i'},
+    {"filter",      1, NULL, 'f'},
+    {"stats",       0, NULL, 's'},
+    {"top",         1, NULL, 'T'},
+    {"discover",    0, NULL, 'D'},
+    {"threads",     0, NULL, 'H'},
+    {"containers",  0, NULL, 'C'},
+    {"stream",      0, NULL, 'S'},
+    {"backend",     1, NULL, 'B'},
+    {"format",      1, NULL, 'F'},
+    {"progressive", 0, NULL, 'P'},
+    {"profile",     0, NULL, 'R'},
+    {"jobs",        1, NULL, 'J'},
+    {"gentle",      2, NULL, 'G'},
+    {"deadline",    1, NULL, 'L'},
+    {"cpu-budget",  1, NULL, 'U'},
+    {"ns-pid",      1, NULL, 'N'},
+    {NULL,          0, NULL, 0}
   };
 
   // Initialize info.
@@ -159,19 +361,27 @@ int init(const int argc, char *argv[]) {
     return RET_ERR_NOMEM;
   }
   info->args->flags = 0;
-  info->args->pid = 0;
-  info->args->ns = 0;
-  if (!(info->args->proc_mnt = malloc(strlen(PROCMNT)+1))) {
-    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+  info->args->nqueries = 0;
+  info->args->top = STATS_TOP;
+  info->args->format = FORMAT_TREE;
+  info->args->jobs = 0;
+  info->args->rate = 0;
+  info->args->deadline = 0;
+  info->args->cpu_budget = 0;
+  info->args->queries = NULL;
+  info->args->filter = NULL;
+  info->args->nroots = 0;
+  if (insert_root(info->args, PROCMNT) != RET_OK) {
     safe_free((void **)&(info->args));
     safe_free((void **)&info);
     return RET_ERR_NOMEM;
   }
-  memset(info->args->proc_mnt, 0, strlen(PROCMNT)+1);
-  strncpy(info->args->proc_mnt, PROCMNT, strlen(PROCMNT));
   
   info->process = NULL;
-  for (ns = 0; ns < NSCOUNT; ns++) {
+  info->pids = NULL;
+  info->cgroups = NULL;
+  info->ns_index = NULL;
+  for (ns = 0; ns < NSMAX; ns++) {
     info->namespace[ns] = NULL;
     info->args->wanted[ns] = 0;
   }
@@ -192,20 +402,8 @@ int init(const int argc, char *argv[]) {
 	info->args->flags |= FLAG_NSWANT;
 	token = strtok(optarg, delim);
 	while (token) {
-	  if (!strcmp(token, "IPC")) 
-	    info->args->wanted[IPC] = 1;
-	  else if (!strcmp(token, "MNT")) 
-	    info->args->wanted[MNT] = 1;
-	  else if (!strcmp(token, "NET")) 
-	    info->args->wanted[NET] = 1;
-	  else if (!strcmp(token, "PID")) 
-	    info->args->wanted[PID] = 1;
-	  else if (!strcmp(token, "USER")) 
-	    info->args->wanted[USER] = 1;
-	  else if (!strcmp(token, "UTS")) 
-	    info->args->wanted[UTS] = 1;
-	  else if (!strcmp(token, "CGROUP")) 
-	    info->args->wanted[CGROUP] = 1;
+	  if ((type = get_type_from_name(token)) < NSCOUNT)
+	    info->args->wanted[type] = 1;
 	  else {
 	    fprintf(stderr, "nscat: Unrecognized namespace parameter.\n");
 	    clear_info();
@@ -216,10 +414,122 @@ int init(const int argc, char *argv[]) {
 	}
 	break;
       case 'n':
-	info->args->ns = atol(optarg);	
+	if (parse_query_list(QUERY_NS, optarg) != RET_OK) {
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
 	break;
       case 'p':
-	info->args->pid = atol(optarg);
+	if (parse_query_list(QUERY_PID, optarg) != RET_OK) {
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'f':
+	delete_filter(&(info->args->filter));
+	if (!(info->args->filter = compile_filter(optarg))) {
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 's':
+	info->args->flags |= FLAG_STATS;
+	break;
+      case 'T':
+	info->args->flags |= FLAG_STATS;
+	info->args->top = strtoul(optarg, &end, 10);
+	if (end == optarg || *end != 0) {
+	  fprintf(stderr, "nscat: Invalid number '%s'.\n", optarg);
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'D':
+	info->args->flags |= FLAG_DISCOVER;
+	break;
+      case 'C':
+	info->args->flags |= FLAG_CONTAINER;
+	break;
+      case 'S':
+	info->args->flags |= FLAG_STREAM;
+	break;
+      case 'B':
+	if (select_backend(optarg) != RET_OK) {
+	  fprintf(stderr, "nscat: Unknown backend '%s'.\n", optarg);
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'F':
+	if ((info->args->format = get_format_from_name(optarg)) == FORMAT_NONE) {
+	  fprintf(stderr, "nscat: Unknown output format '%s'.\n", optarg);
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'P':
+	info->args->flags |= FLAG_PROGRESS;
+	break;
+      case 'R':
+	info->args->flags |= FLAG_PROFILE;
+	break;
+      case 'G':
+	info->args->flags |= FLAG_GENTLE;
+	if (optarg) {
+	  info->args->rate = strtoul(optarg, &end, 10);
+	  if (end == optarg || *end != 0 || !(info->args->rate)) {
+	    fprintf(stderr, "nscat: Invalid number '%s'.\n", optarg);
+	    clear_info();
+	    print_usage(1);
+	    return RET_ERR_PARAM;
+	  }
+	}
+	break;
+      case 'L':
+      case 'U':
+	if (next_option == 'L')
+	  info->args->deadline = strtod(optarg, &end);
+	else
+	  info->args->cpu_budget = strtod(optarg, &end);
+	if (end == optarg || *end != 0 ||
+	    (next_option == 'L' ? info->args->deadline : info->args->cpu_budget) <= 0) {
+	  fprintf(stderr, "nscat: Invalid number '%s'.\n", optarg);
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'J':
+	info->args->jobs = strtoul(optarg, &end, 10);
+	if (end == optarg || *end != 0 || !(info->args->jobs)) {
+	  fprintf(stderr, "nscat: Invalid number '%s'.\n", optarg);
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'H':
+	info->args->flags |= FLAG_THREADS;
+	break;
+      case 'N':
+	if (parse_query_list(QUERY_NSPID, optarg) != RET_OK) {
+	  clear_info();
+	  print_usage(1);
+	  return RET_ERR_PARAM;
+	}
+	break;
+      case 'i':
+	info->args->flags |= FLAG_BATCH;
+	from_stdin = 1;
+	break;
+      case 'a':
+	info->args->flags |= FLAG_ACCOUNT;
 	break;
       case 'd':
 	info->args->flags |= FLAG_DESCS;	
@@ -228,16 +538,18 @@ int init(const int argc, char *argv[]) {
 	info->args->flags |= FLAG_PROCESS;	
 	break;
       case 'm':
-	if (strlen(optarg) > 0) {	  
-	  safe_free((void **)&(info->args->proc_mnt));
-	  if (!(info->args->proc_mnt = malloc(strlen(optarg)+1))) {
-	    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+	// The first root given replaces the default one. The rest are
+	// added to it, either as a list or with more -m options.
+	if (!mounts++) {
+	  for (i = 0; i < info->args->nroots; i++)
+	    safe_free((void **)&(info->args->proc_mnt[i]));
+	  info->args->nroots = 0;
+	}
+	for (token = strtok(optarg, delim); token; token = strtok(NULL, delim))
+	  if (insert_root(info->args, token) != RET_OK) {
 	    clear_info();
-	    return RET_ERR_NOMEM;
+	    return RET_ERR_PARAM;
 	  }
-	  memset(info->args->proc_mnt, 0, strlen(optarg)+1);
-	  strncpy(info->args->proc_mnt, optarg, strlen(optarg));
-	}	
 	break;	
       case 'e':
 	info->args->flags |= FLAG_EXTEND;	
@@ -251,6 +563,88 @@ int init(const int argc, char *argv[]) {
 	return RET_ERR_PARAM;
     }
   } while (next_option != -1);
+
+  // Read the queries from the standard input before scanning.
+  if (from_stdin)
+    if (read_queries(stdin) != RET_OK) {
+      clear_info();
+      return RET_ERR_PARAM;
+    }
+
+  // Streaming keeps no member lists and no process list.
+  if (info->args->flags & FLAG_STREAM) {
+    for (i = 0; i < info->args->nqueries; i++)
+      if (info->args->queries[i].type != QUERY_NS)
+	break;
+    if (i < info->args->nqueries ||
+	(info->args->flags & (FLAG_PROCESS|FLAG_DESCS|FLAG_THREADS|FLAG_CONTAINER))) {
+      fprintf(stderr, "nscat: --stream cannot be combined with -r, -d, -p, "
+	      "--ns-pid, --threads or --containers.\n");
+      clear_info();
+      return RET_ERR_PARAM;
+    }
+  }
+
+  // Without a -m path the default root is kept.
+  if (!info->args->nroots && insert_root(info->args, PROCMNT) != RET_OK) {
+    clear_info();
+    return RET_ERR_NOMEM;
+  }
+
+  // The namespaces of roots that may come from different kernels are
+  // kept apart. The memory backend holds a single root.
+  if (info->args->nroots > 1) {
+    if (!backend->kernel)
+      info->args->flags |= FLAG_SPLITROOTS;
+    if (backend->init) {
+      fprintf(stderr, "nscat: The %s backend reads a single procfs root.\n",
+	      backend->name);
+      clear_info();
+      return RET_ERR_PARAM;
+    }
+    if ((info->args->flags & FLAG_STREAM) && (info->args->flags & FLAG_SPLITROOTS)) {
+      fprintf(stderr, "nscat: --stream needs the procfs roots of one kernel.\n");
+      clear_info();
+      return RET_ERR_PARAM;
+    }
+  }
+
+  // Records are flat, one per namespace.
+  if ((info->args->flags & FLAG_PROGRESS) &&
+      (info->args->nqueries ||
+       (info->args->flags & (FLAG_PROCESS|FLAG_DESCS|FLAG_EXTEND|FLAG_STATS)))) {
+    fprintf(stderr, "nscat: --progressive cannot be combined with -r, -d, -e, "
+	    "-n, -p, --ns-pid or --stats.\n");
+    clear_info();
+    return RET_ERR_PARAM;
+  }
+
+  // Graphs and metrics cover the whole hierarchy. The metrics are the
+  // statistics, so --top sets the number of namespaces they list.
+  if (info->args->format != FORMAT_TREE &&
+      (info->args->nqueries || (info->args->flags & FLAG_PROGRESS) ||
+       (info->args->format != FORMAT_OPENMETRICS && (info->args->flags & FLAG_STATS)))) {
+    fprintf(stderr, "nscat: --format %s cannot be combined with -n, -p, --ns-pid, "
+	    "--stats or --progressive.\n", get_name_from_format(info->args->format));
+    clear_info();
+    return RET_ERR_PARAM;
+  }
+
+  // Step aside for the other processes of the node.
+  if (info->args->flags & FLAG_GENTLE)
+    lower_priority();
+
+  // Load the process information of backends that read it up front.
+  // Where the task iterator cannot be used, procfs is read instead.
+  if (backend->init && backend->init(info->args->proc_mnt[0]) != RET_OK) {
+    if (strcmp(backend->name, "bpf")) {
+      clear_info();
+      return RET_ERR_NOFILE;
+    }
+    fprintf(stderr, "nscat: Warning - The bpf backend is not available. "
+	    "Falling back to procfs.\n");
+    select_backend("procfs");
+  }
   return check_environment();
 }
 
@@ -258,24 +652,40 @@ int init(const int argc, char *argv[]) {
  * @name main
  */
 int32_t main(int argc, char *argv[]) {
+  unsigned short profiling;
   
   // Perform initialization.
+  start_phase(PHASE_INIT);
   if (init(argc, argv) != RET_OK)
     exit(EXIT_FAILURE);
+  profiling = (info->args->flags & FLAG_PROFILE) != 0;
 
   // Collect all the processes.
+  start_phase(PHASE_COLLECT);
   if (collect_processes() != RET_OK)
     exit(EXIT_FAILURE);
 
   // Retrieve the namespace information.
+  start_phase(PHASE_BUILD);
   if (build_info() != RET_OK)
     exit(EXIT_FAILURE);
 
+  // Find the namespaces that are not reachable through processes.
+  start_phase(PHASE_DISCOVER);
+  if (info->args->flags & FLAG_DISCOVER)
+    if (discover_namespaces() != RET_OK)
+      exit(EXIT_FAILURE);
+
   // Print the namespace information.
+  start_phase(PHASE_PRINT);
   print_info();
 
   // Free up memory.
+  start_phase(PHASE_CLEAR);
   clear_info();
+
+  if (profiling)
+    print_profile();
   
   exit(EXIT_SUCCESS);
 }
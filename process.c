@@ -13,18 +13,37 @@
  */
 #define _XOPEN_SOURCE 500
 #define _GNU_SOURCE
+#include <dirent.h>
 #include <errno.h>
-#include <ftw.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include "backend.h"
+#include "cgroup.h"
 #include "common.h"
+#include "filter.h"
+#include "gentle.h"
 #include "info.h"
 #include "namespace.h"
 #include "process.h"
+#include "profile.h"
+
+// The procfs root and the process list that handle_proc_entry fills
+// in. Each thread that walks a root has its own.
+static __thread unsigned short walk_root = 0;
+static __thread list_t **walk_list = NULL;
+
+// A procfs root that is walked by its own thread.
+typedef struct walk_job {
+  unsigned short root;
+  list_t *list;
+  int status;
+  profile_t *profile;
+} walk_job_t;
 
 /**
  * @name create_emtpy_process - Create an empty process object.
@@ -34,7 +53,8 @@ process_t *create_empty_process() {
   unsigned short type; 
   process_t *p;
   
-  if (!(p = malloc(sizeof(process_t)))) {
+  // The namespace array is allocated along with the process.
+  if (!(p = malloc(sizeof(process_t) + NSMAX * sizeof(namespace_t *)))) {
     report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
     return NULL;
   }
@@ -42,16 +62,20 @@ process_t *create_empty_process() {
   p->pid = p->ppid = 0;
   p->uid = 0;
   p->gid = 0;
+  p->types = (unsigned short)~0;
+  p->root = 0;
+  p->utime = p->stime = p->rss = 0;
+  p->tgid = 0;
+  p->threads = 1;
+  p->nslevels = 0;
+  p->nspid = NULL;
+  p->nids = NULL;
+  p->cgroup = NULL;
   p->name = NULL;
   p->parent = NULL;  
-  
-  if (!(p->namespace = malloc(NSCOUNT * sizeof(namespace_t)))) {
-    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
-    safe_free((void **)&p);
-    return NULL;
-  }
+  p->namespace = (namespace_t **)(p + 1);
 
-  for (type = 0; type < NSCOUNT; type++) 
+  for (type = 0; type < NSMAX; type++) 
     p->namespace[type] = NULL;
   return p;
 }
@@ -70,10 +94,11 @@ void delete_process(process_t **p) {
   }
   
   (*p)->parent = NULL;
-  for (type = 0; type < NSCOUNT; type++) 
+  for (type = 0; type < NSMAX; type++) 
     (*p)->namespace[type] = NULL;
   safe_free((void **)&((*p)->name));
-  safe_free((void **)&(*p)->namespace);    
+  safe_free((void **)&((*p)->nspid));
+  safe_free((void **)&((*p)->nids));
   safe_free((void **)p);
 }
 
@@ -163,10 +188,12 @@ process_t *search_process_list(list_t *l, const pid_t pid) {
     return NULL;
   }
 
-  for (c = l; c; c = c->next) 
+  for (c = l; c; c = c->next) {
+    PROFILE_COUNT(probes, 1);
     if (c->process) 
       if (c->process->pid == pid)
 	return c->process;
+  }
   return NULL;
 }
 
@@ -252,6 +279,88 @@ int get_proc_ppid(const char *proc_path, pid_t *ppid) {
   return RET_ERR_NOENTRY;
 }
 
+/**
+ * @name parse_proc_nspid - Parse the NSpid field of a status file.
+ * @param field: The field value, i.e. the text after "NSpid:".
+ * @param p: Pointer to the process object.
+ * @return RET_OK on sucess, an error code on error.
+ *
+ * NSpid lists the PID of the process in each PID namespace it belongs
+ * to, from the namespace of procfs down to the innermost one. The list
+ * is kept only for processes in nested PID namespaces.
+ */
+static int parse_proc_nspid(const char *field, process_t *p) {
+  unsigned short levels = 0, i;
+  const char *c;
+  char *end;
+
+  for (c = field; *c; ) {
+    strtol(c, &end, 10);
+    if (end == c)
+      break;
+    levels++;
+    c = end;
+  }
+  if (levels < 2)
+    return RET_OK;
+
+  safe_free((void **)&(p->nspid));
+  if (!(p->nspid = malloc(levels * sizeof(pid_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  for (c = field, i = 0; i < levels; i++, c = end)
+    p->nspid[i] = strtol(c, &end, 10);
+  p->nslevels = levels;
+  return RET_OK;
+}
+
+/**
+ * @name get_proc_status - Read the status file of a process.
+ * @param proc_path: The process path in procfs.
+ * @param p: Pointer to the process object where the parent PID,
+ *           the namespace PIDs and the number of threads will be placed.
+ * @return RET_OK on sucess, an error code on error.
+ *
+ * The status file is read once and all the fields nscat needs are
+ * taken from that single read.
+ */
+int get_proc_status(const char *proc_path, process_t *p) {
+  char buffer[ATTR_SIZE];
+  char *line, *next;
+  unsigned short found = 0;
+  size_t length;
+  int status;
+
+  if (!proc_path || !p) {
+    report_error("get_proc_status", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  if ((status = backend->read_attr(proc_path, PROCSTATUSFILE, buffer,
+				   sizeof(buffer), &length)) != RET_OK)
+    return status;
+  for (line = buffer; line && *line; line = next) {
+    if ((next = strchr(line, '\n')))
+      *next++ = 0;
+    if (!strncmp(line, "PPid:", 5)) {
+      p->ppid = atoi(line + 5);
+      found = 1;
+    } else if (!strncmp(line, "NSpid:", 6)) {
+      if (parse_proc_nspid(line + 6, p) != RET_OK)
+	return RET_ERR_NOMEM;
+    } else if (!strncmp(line, "Threads:", 8)) {
+      p->threads = strtoul(line + 8, NULL, 10);
+      // Threads is the last field nscat needs.
+      break;
+    }
+  }
+  if (!found) {
+    report_error("get_proc_status", debug_message(RET_ERR_NOENTRY), DEBUG_MSG);
+    return RET_ERR_NOENTRY;
+  }
+  return RET_OK;
+}
+
 /**
  * @name get_proc_name - Get the name of a process.
  * @param proc_path: The process path in procfs.
@@ -259,35 +368,23 @@ int get_proc_ppid(const char *proc_path, pid_t *ppid) {
  * @return RET_OK on sucess, an error code on error.
  */
 int get_proc_name(const char *proc_path, char **pname) {
-  unsigned int size;
-  FILE *fd;
-  char *target_path;
+  char buffer[BUFFER_SIZE];
+  char *name = buffer;
+  size_t length;
+  int status;
 
   if (!proc_path || !pname) {
     report_error("get_proc_name", debug_message(RET_ERR_PARAM), DEBUG_MSG);  
     return RET_ERR_PARAM;
   }
-  size = strlen(proc_path) + strlen(PROCNAMEFILE) + 1;  
-  if (!(target_path = malloc(size+1))) {
-    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);    
-    return RET_ERR_NOMEM;
-  }
-  memset(target_path, 0, size+1);
-  snprintf(target_path, size, "%s%s\0", proc_path, PROCNAMEFILE);
-  if (!(fd = fopen(target_path, "r"))) {    
-    report_error(target_path, strerror(errno), DEBUG_MSG);
-    safe_free((void **)&target_path);
-    return RET_ERR_NOFILE;
-  }
-  safe_free((void **)&target_path);
-  if (!(*pname = malloc(BUFFER_SIZE))) {    
+  if ((status = backend->read_attr(proc_path, PROCNAMEFILE, buffer, BUFFER_SIZE,
+				   &length)) != RET_OK)
+    return status;
+  delete_spaces(&name);
+  if (!(*pname = strdup(name))) {
     report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);    
     return RET_ERR_NOMEM;
   }
-  memset(*pname, 0, BUFFER_SIZE);
-  fgets(*pname, BUFFER_SIZE, fd);
-  fclose(fd);
-  delete_spaces(pname);    
   return RET_OK;
 }
 
@@ -298,19 +395,13 @@ int get_proc_name(const char *proc_path, char **pname) {
  * @return RET_OK on sucess, an error code on error.
  */
 int get_proc_uid(const char *proc_path, uid_t *uid) {
-  char buffer[BUFFER_SIZE];
-  struct stat sb;
+  gid_t gid;
   
   if (!proc_path || !uid) {
     report_error("get_proc_uid", debug_message(RET_ERR_PARAM), DEBUG_MSG);
     return RET_ERR_PARAM;
   }
-  if (stat(proc_path, &sb)) {
-    report_error("get_proc_uid", strerror(errno), DEBUG_MSG);
-    return RET_ERR_NOLINK;
-  }
-  *uid =  sb.st_uid;
-  return RET_OK;
+  return backend->get_owner(proc_path, uid, &gid);
 }
 
 /**
@@ -320,106 +411,520 @@ int get_proc_uid(const char *proc_path, uid_t *uid) {
  * @return RET_OK on sucess, an error code on error.
  */
 int get_proc_gid(const char *proc_path, gid_t *gid) {
-  char buffer[BUFFER_SIZE];
-  struct stat sb;
+  uid_t uid;
   
   if (!proc_path || !gid) {
     report_error("get_proc_gid", debug_message(RET_ERR_PARAM), DEBUG_MSG);
     return RET_ERR_PARAM;
   }
-  if (stat(proc_path, &sb)) {
-    report_error("get_proc_gid", strerror(errno), DEBUG_MSG);
-    return RET_ERR_NOLINK;
+  return backend->get_owner(proc_path, &uid, gid);
+}
+
+/**
+ * @name get_proc_stat - Get the resource usage of a process.
+ * @param proc_path: The process path in procfs.
+ * @param p: Pointer to the process object where the user and system
+ *           CPU time (in clock ticks) and the resident set size (in
+ *           pages) will be placed.
+ * @return RET_OK on sucess, an error code on error.
+ */
+int get_proc_stat(const char *proc_path, process_t *p) {
+  char buffer[BUFFER_SIZE];
+  char *fields;
+  size_t length;
+  int status;
+
+  if (!proc_path || !p) {
+    report_error("get_proc_stat", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  if ((status = backend->read_attr(proc_path, PROCSTATFILE, buffer,
+				   sizeof(buffer), &length)) != RET_OK)
+    return status;
+
+  // The command name may contain spaces and parentheses, so the fields
+  // are counted from the last ')'. The first one after it is field 3.
+  if (!(fields = strrchr(buffer, ')')) ||
+      sscanf(fields + 1, "%*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %lu %lu "
+	     "%*s %*s %*s %*s %*s %*s %*s %*s %lu",
+	     &(p->utime), &(p->stime), &(p->rss)) != 3) {
+    report_error("get_proc_stat", debug_message(RET_ERR_NOENTRY), DEBUG_MSG);
+    return RET_ERR_NOENTRY;
   }
-  *gid =  sb.st_gid;
   return RET_OK;
 }
 
 /**
- * @name handle_proc_entry - Process nftw entry.
- * @param fpath: The pathname of an entry found by nftw.
- * @param sb: Pointer to a struct structure for the entry.
- * @param tflag: flags.
- * @param ftwbuf: pointer to struct FTW.
- * @return FTW code that instructs nftw to continue, to stop,
- *         or to skip a particular subtree entirely.
+ * @name scan_proc_threads - Find the threads whose namespaces diverge.
+ * @param proc_path: The process path in procfs.
+ * @param p: Pointer to the process object.
+ * @param nids: The namespace IDs of the process, as read by
+ *              get_proc_namespaces().
+ * @return RET_OK on success, or an error code in case of an error.
  *
- * This method is called for each entry found by nftw. its purpose
- * is to create a new process object for the entry and add in the
- * process list.
+ * A thread can unshare or setns on its own. This method compares the
+ * namespaces of every other thread of p with those of p. Each thread
+ * that differs is added to the process list as a thread object whose
+ * types are only the divergent ones, so that it becomes a member of
+ * just those namespaces. Threads that match p are not recorded.
  */
-int handle_proc_entry(const char *fpath, const struct stat *sb,
-		      int tflag, struct FTW *ftwbuf) {
-  ino_t nid;
-  unsigned short type;
-  pid_t pid, ppid;
-  process_t *p = NULL;
+int scan_proc_threads(const char *proc_path, process_t *p, const ino_t *nids) {
+  char task_path[BUFFER_SIZE];
+  ino_t tnids[NSMAX];
+  struct dirent *entry;
+  unsigned short type, types;
+  process_t *t;
+  pid_t tid;
+  DIR *dir;
+  int status = RET_OK;
+
+  if (!proc_path || !p || !nids) {
+    report_error("scan_proc_threads", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+  snprintf(task_path, sizeof(task_path), "%s%s", proc_path, PROCTASKDIR);
+  PROFILE_COUNT(opens, 1);
+  if (!(dir = opendir(task_path))) {
+    report_error(task_path, strerror(errno), DEBUG_MSG);
+    return RET_ERR_NOFILE;
+  }
 
-  if (!fpath || !sb || !ftwbuf) {
+  while ((entry = readdir(dir))) {
+    if (!(tid = atoi(entry->d_name)) || tid == p->pid)
+      continue;
+    snprintf(task_path, sizeof(task_path), "%s%s/%d", proc_path, PROCTASKDIR, tid);
+    if (get_proc_namespaces(task_path, tnids) != RET_OK)
+      continue;
+    types = 0;
+    for (type = 0; type < NSCOUNT; type++)
+      if (tnids[type] && tnids[type] != nids[type])
+	types |= 1 << type;
+    if (!(types &= p->types))
+      continue;
+
+    // Record the divergent thread.
+    if (!(t = create_empty_process())) {
+      status = RET_ERR_NOMEM;
+      break;
+    }
+    t->pid = tid;
+    t->tgid = p->pid;
+    t->ppid = p->pid;
+    t->uid = p->uid;
+    t->gid = p->gid;
+    t->types = types;
+    t->root = p->root;
+    t->cgroup = p->cgroup;
+
+    // In a paced scan the IDs are kept with the thread, like those of p.
+    if (p->nids) {
+      if (!(t->nids = malloc(NSMAX * sizeof(ino_t)))) {
+	delete_process(&t);
+	status = RET_ERR_NOMEM;
+	break;
+      }
+      memcpy(t->nids, tnids, NSMAX * sizeof(ino_t));
+    }
+    if (get_proc_status(task_path, t) == RET_ERR_NOMEM) {
+      delete_process(&t);
+      status = RET_ERR_NOMEM;
+      break;
+    }
+    t->ppid = p->pid;
+    t->threads = 1;
+    if (get_proc_name(task_path, &(t->name)) != RET_OK &&
+	!(t->name = strdup(p->name ? p->name : ""))) {
+      delete_process(&t);
+      status = RET_ERR_NOMEM;
+      break;
+    }
+    if ((status = insert_process_list(&(info->process), t)) != RET_OK) {
+      delete_process(&t);
+      break;
+    }
+  }
+  closedir(dir);
+  return status;
+}
+
+/**
+ * @name get_proc_path - Get the procfs path of a process.
+ * @param p: Pointer to the process object.
+ * @param path: The buffer where the path will be placed.
+ * @param size: The size of the buffer.
+ * @return Void.
+ */
+void get_proc_path(const process_t *p, char *path, const size_t size) {
+  snprintf(path, size, "%s/%d", info->args->proc_mnt[p->root], p->pid);
+}
+
+/**
+ * @name set_walk_target - Set where the processes of a walk are placed.
+ * @param root: The procfs root that is walked.
+ * @param list: The address of the process list to fill in, or NULL for
+ *              the main process list.
+ * @return Void.
+ */
+void set_walk_target(const unsigned short root, list_t **list) {
+  walk_root = root;
+  walk_list = list;
+}
+
+/**
+ * @name read_walk_namespaces - Read the namespace IDs of a process now.
+ * @param proc_path: The process path in procfs.
+ * @param p: Pointer to the process object.
+ * @return RET_OK on success, or RET_ERR_NOMEM if there is not enough
+ *         memory.
+ *
+ * A paced scan reads the namespaces of each process, and the threads
+ * whose namespaces diverge, while it walks the processes, so that the
+ * pace, the deadline and the CPU budget hold for all of its procfs
+ * reads. The IDs are kept in p->nids until link_processes() takes
+ * them. The IDs of a process whose namespaces cannot be read are left
+ * 0, so that it joins no namespace.
+ */
+static int read_walk_namespaces(const char *proc_path, process_t *p) {
+  if (!(p->nids = calloc(NSMAX, sizeof(ino_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  if (get_proc_namespaces(proc_path, p->nids) != RET_OK) {
+    memset(p->nids, 0, NSMAX * sizeof(ino_t));
+    return RET_OK;
+  }
+  if ((info->args->flags & FLAG_THREADS) && p->threads > 1 && !p->tgid &&
+      scan_proc_threads(proc_path, p, p->nids) == RET_ERR_NOMEM)
+    return RET_ERR_NOMEM;
+  return RET_OK;
+}
+
+/**
+ * @name handle_proc_entry - Process a process found by the backend.
+ * @param fpath: The process path.
+ * @param pid: The process ID.
+ * @return RET_OK to continue with the next process, or an error code
+ *         to stop the scan.
+ *
+ * This method is called for each process found by the backend. its
+ * purpose is to create a new process object for the entry and add in
+ * the process list. Processes that vanish while they are read are
+ * skipped.
+ */
+int handle_proc_entry(const char *fpath, const pid_t pid) {
+  process_t *p = NULL, probe;
+  filter_t *f = info->args->filter;
+
+  if (!fpath || !pid) {
     report_error("handle_proc_entry", debug_message(RET_ERR_PARAM), DEBUG_MSG);
-    return FTW_STOP;
+    return RET_ERR_PARAM;
   }
- 
-  // We are interested only for process directories.
-  if (!(pid = atoi(fpath + ftwbuf->base)))
-    if (ftwbuf->level >= 1 && tflag == FTW_D)
-      return FTW_SKIP_SUBTREE;
-    else
-      return FTW_CONTINUE;  
 
-  // Get the parent PID.
-  if ((get_proc_ppid(fpath, &ppid)) != RET_OK) 
-    return FTW_CONTINUE;
+  // Apply the filter as soon as the attributes it needs are known,
+  // so that rejected processes are never fully read.
+  if (f) {
+    probe.pid = pid;
+    if (eval_filter(f, &probe, 1 << FIELD_PID, 0) == FILTER_FALSE)
+      return RET_OK;
+  }
 
   // Store the process information that we have so far.
   if (!(p = create_empty_process()))
-    return FTW_CONTINUE;
+    return RET_ERR_NOMEM;
   p->pid = pid;
-  p->ppid = ppid;
+  p->root = walk_root;
   p->name = NULL;
+
+  // Get the parent PID and the rest of the status fields.
+  if ((get_proc_status(fpath, p)) != RET_OK) {
+    delete_process(&p);
+    return RET_OK;
+  }
+  if (f && eval_filter(f, p, (1 << FIELD_PID)|(1 << FIELD_PPID), 0) == FILTER_FALSE) {
+    delete_process(&p);
+    return RET_OK;
+  }
   if ((get_proc_name(fpath, &(p->name))) != RET_OK) {
-    safe_free((void **)&p); 
-    return FTW_CONTINUE;
+    delete_process(&p);
+    return RET_OK;
+  }
+  if (f && eval_filter(f, p, (1 << FIELD_PID)|(1 << FIELD_PPID)|(1 << FIELD_COMM),
+		       0) == FILTER_FALSE) {
+    delete_process(&p);
+    return RET_OK;
   }
   if ((get_proc_uid(fpath, &(p->uid))) != RET_OK) {
-    safe_free((void **)&p); 
-    return FTW_CONTINUE;
+    delete_process(&p);
+    return RET_OK;
   }
   if ((get_proc_gid(fpath, &(p->gid))) != RET_OK) {
-    safe_free((void **)&p); 
-    return FTW_CONTINUE;
+    delete_process(&p);
+    return RET_OK;
+  }
+
+  // Read the resource usage only when it will be accounted.
+  if (info->args->flags & FLAG_ACCOUNT)
+    get_proc_stat(fpath, p);
+
+  // Find the container of the process.
+  if ((info->args->flags & FLAG_CONTAINER) &&
+      get_proc_cgroup(fpath, p) == RET_ERR_NOMEM) {
+    delete_process(&p);
+    return RET_ERR_NOMEM;
   }
-	  
+
+  // Find the namespace types this process passes the filter for.
+  if (f && !(p->types = filter_process_types(f, p))) {
+    delete_process(&p);
+    return RET_OK;
+  }
+
+  // A paced scan reads the namespaces during the walk.
+  if (is_paced_scan() && !(info->args->flags & FLAG_STREAM) &&
+      read_walk_namespaces(fpath, p) == RET_ERR_NOMEM) {
+    delete_process(&p);
+    return RET_ERR_NOMEM;
+  }
+
+  // In streaming mode the process is accounted and dropped right away.
+  if (info->args->flags & FLAG_STREAM)
+    return stream_process(fpath, &p) == RET_ERR_NOMEM ? RET_ERR_NOMEM : RET_OK;
+
   // Add this process to the process list.
-  if ((insert_process_list(&(info->process), p)) != RET_OK) {
-    safe_free((void **)&p);
-    return FTW_CONTINUE;
+  if ((insert_process_list(walk_list ? walk_list : &(info->process), p)) != RET_OK) {
+    delete_process(&p);
+    return RET_OK;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name walk_worker - Collect the processes of one procfs root.
+ * @param arg: Pointer to the walk job.
+ * @return NULL.
+ */
+static void *walk_worker(void *arg) {
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  walk_job_t *job = arg;
+
+  profile.phase = PHASE_COLLECT;
+  set_walk_target(job->root, &(job->list));
+  job->status = backend->walk(info->args->proc_mnt[job->root], handle_proc_entry);
+  set_walk_target(0, NULL);
+
+  // Hand the counters of this thread over to the main thread.
+  pthread_mutex_lock(&lock);
+  merge_profile(job->profile);
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+/**
+ * @name collect_roots - Collect the processes of every procfs root at once.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * Each root is walked by its own thread into a list of its own. The
+ * lists are then joined in the order the roots were given, so that the
+ * output does not depend on which thread finished first. A root whose
+ * thread cannot be started is walked by the calling thread.
+ */
+static int collect_roots() {
+  pthread_t threads[ROOTMAX];
+  walk_job_t jobs[ROOTMAX];
+  unsigned short started[ROOTMAX];
+  unsigned short root;
+  list_t **tail;
+  int status = RET_OK;
+
+  for (root = 0; root < info->args->nroots; root++) {
+    jobs[root].root = root;
+    jobs[root].list = NULL;
+    jobs[root].status = RET_OK;
+    jobs[root].profile = &profile;
+    started[root] = !pthread_create(&threads[root], NULL, walk_worker, &jobs[root]);
+  }
+  for (root = 0; root < info->args->nroots; root++) {
+    if (started[root])
+      pthread_join(threads[root], NULL);
+    else
+      walk_worker(&jobs[root]);
   }
 
-  // Skip subdirectories.
-   if (ftwbuf->level >= 1 && tflag == FTW_D)
-     return FTW_SKIP_SUBTREE;
-   else
-     return FTW_CONTINUE;  
+  // Append the lists to the main process list in root order.
+  for (tail = &(info->process); *tail; tail = &((*tail)->next));
+  for (root = 0; root < info->args->nroots; root++) {
+    *tail = jobs[root].list;
+    for (; *tail; tail = &((*tail)->next));
+    if (status == RET_OK)
+      status = jobs[root].status;
+  }
+  return status;
 }
 
 /**
  * @name collect_processes - Find all process that have entries in procfs.
  * @return RET_OK on success, or an error code in case of an error.
  *
- * This method uses nftw to search the path where the procfs is mounted for
- * processes.
+ * This method asks the backend for every process under each path where
+ * a procfs is mounted. Several roots are walked in parallel, except in
+ * streaming mode, where the namespaces are built during the walk.
  */
 int collect_processes() {
+  unsigned short root;
+  int status;
+
   if (!info || !(info->args)) {
     report_error("collect_processes", debug_message(RET_ERR_PARAM), DEBUG_MSG);
     return RET_ERR_PARAM;
   }
+  if (is_paced_scan())
+    return collect_processes_gently();
+  if (info->args->nroots > 1 && !(info->args->flags & FLAG_STREAM))
+    return collect_roots();
 
-  // Process the /proc directory.
-  if (nftw(info->args->proc_mnt, handle_proc_entry, 20, FTW_ACTIONRETVAL|FTW_PHYS) == -1) {
-    report_error(NULL, strerror(errno), ERROR_MSG);
-    return RET_ERR_NOFILE;
+  for (root = 0; root < info->args->nroots; root++) {
+    set_walk_target(root, NULL);
+    status = backend->walk(info->args->proc_mnt[root], handle_proc_entry);
+    set_walk_target(0, NULL);
+    if (status != RET_OK)
+      return status;
+  }
+  return RET_OK;
+}
+
+/**
+ * @name hash_pid_entry - Hash a namespace PID.
+ * @param nid: The PID namespace.
+ * @param pid: The PID inside the namespace.
+ * @param mask: The index size minus one.
+ * @return The slot where the search for the entry starts.
+ */
+static unsigned long hash_pid_entry(const ino_t nid, const pid_t pid,
+				    const unsigned long mask) {
+  unsigned long long h = (unsigned long long)nid * 0x9e3779b97f4a7c15ULL;
+
+  return (unsigned long)((h >> 32) ^ h ^ (unsigned long long)pid *
+			 0xff51afd7ed558ccdULL) & mask;
+}
+
+/**
+ * @name insert_pid_index - Add an entry to a namespace PID index.
+ * @param index: Pointer to an index with at least one free slot.
+ * @param nid: The PID namespace.
+ * @param pid: The PID inside the namespace.
+ * @param p: Pointer to the process.
+ * @return Void.
+ */
+static void insert_pid_index(pid_index_t *index, const ino_t nid,
+			     const pid_t pid, process_t *p) {
+  unsigned long slot = hash_pid_entry(nid, pid, index->size - 1);
+
+  while (index->table[slot].process) {
+    if (index->table[slot].nid == nid && index->table[slot].pid == pid)
+      return;
+    slot = (slot + 1) & (index->size - 1);
+  }
+  index->table[slot].nid = nid;
+  index->table[slot].pid = pid;
+  index->table[slot].process = p;
+  index->count++;
+}
+
+/**
+ * @name build_pid_index - Index the processes by their namespace PIDs.
+ * @param index: The address of the index that will be created.
+ * @param l: The process list.
+ * @return RET_OK on success, or an error code in case of an error.
+ *
+ * A process in nested PID namespaces has one PID in each of them. Its
+ * innermost PID belongs to the namespace it is a member of, and each
+ * outer PID to the parent of the previous namespace. Every (namespace,
+ * PID) pair is kept in an open addressing hash table, so that a PID
+ * seen inside a container is translated in constant time. Processes
+ * without a PID namespace, e.g. when it was excluded with -t, are not
+ * indexed.
+ */
+int build_pid_index(pid_index_t **index, list_t *l) {
+  unsigned long entries = 0, size = 16;
+  unsigned short level;
+  namespace_t *ns;
+  tree_t *node;
+  list_t *c;
+
+  if (!index) {
+    report_error("build_pid_index", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  for (c = l; c; c = c->next)
+    entries += c->process->nslevels ? c->process->nslevels : 1;
+  while (size < 2 * entries)
+    size <<= 1;
+
+  if (!(*index = malloc(sizeof(pid_index_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  if (!((*index)->table = calloc(size, sizeof(pid_entry_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    safe_free((void **)index);
+    return RET_ERR_NOMEM;
+  }
+  (*index)->size = size;
+  (*index)->count = 0;
+
+  for (c = l; c; c = c->next) {
+    if (!(ns = c->process->namespace[PID]))
+      continue;
+    if (!c->process->nslevels) {
+      insert_pid_index(*index, ns->nid, c->process->pid, c->process);
+      continue;
+    }
+    // Walk from the innermost namespace outwards.
+    for (level = c->process->nslevels; level > 0 && ns; level--) {
+      insert_pid_index(*index, ns->nid, c->process->nspid[level - 1], c->process);
+      if (!ns->pnid)
+	break;
+      node = search_namespace_tree(info->namespace[PID], get_ns_root(ns->root),
+				   ns->pnid);
+      ns = node ? node->namespace : NULL;
+    }
   }
   return RET_OK;
 }
+
+/**
+ * @name search_pid_index - Find a process by its namespace PID.
+ * @param index: Pointer to the index.
+ * @param nid: The PID namespace.
+ * @param pid: The PID inside the namespace.
+ * @return Pointer to the process or NULL if it was not found.
+ */
+process_t *search_pid_index(const pid_index_t *index, const ino_t nid,
+			    const pid_t pid) {
+  unsigned long slot;
+
+  if (!index || !(index->size))
+    return NULL;
+
+  slot = hash_pid_entry(nid, pid, index->size - 1);
+  while (index->table[slot].process) {
+    PROFILE_COUNT(probes, 1);
+    if (index->table[slot].nid == nid && index->table[slot].pid == pid)
+      return index->table[slot].process;
+    slot = (slot + 1) & (index->size - 1);
+  }
+  return NULL;
+}
+
+/**
+ * @name clear_pid_index - Release a namespace PID index.
+ * @param index: The address of the index.
+ * @return Void.
+ */
+void clear_pid_index(pid_index_t **index) {
+  if (!index || !(*index))
+    return;
+  safe_free((void **)&((*index)->table));
+  safe_free((void **)index);
+}
@@ -15,20 +15,33 @@
 #ifndef NSCAT_PROCESS_H
 #define NSCAT_PROCESS_H
 
-#include <ftw.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include "namespace.h"
 
 static const char PROCNAMEFILE[] = "/comm";
+static const char PROCSTATFILE[] = "/stat";
+static const char PROCSTATUSFILE[] = "/status";
+static const char PROCTASKDIR[] = "/task";
 
 // Process.
 typedef struct process {
   pid_t pid;
   pid_t ppid;
+  pid_t tgid;
   uid_t uid;
   gid_t gid;
+  unsigned short types;
+  unsigned short root;
+  unsigned long threads;
+  unsigned long utime;
+  unsigned long stime;
+  unsigned long rss;
+  unsigned short nslevels;
+  pid_t *nspid;
+  ino_t *nids;
+  const struct cgroup *cgroup;
   char *name;
   struct process *parent;
   struct namespace **namespace;
@@ -40,21 +53,41 @@ typedef struct list {
   struct list *next;
 } list_t;
 
-struct FTW;
+// An entry of the namespace PID index.
+typedef struct pid_entry {
+  ino_t nid;
+  pid_t pid;
+  struct process *process;
+} pid_entry_t;
+
+// Index from (PID namespace, PID inside it) to processes.
+typedef struct pid_index {
+  struct pid_entry *table;
+  unsigned long size;
+  unsigned long count;
+} pid_index_t;
 
 process_t *create_empty_process();
 void delete_process(process_t **p);
 int get_proc_ppid(const char *proc_path, pid_t *ppid);
+int get_proc_status(const char *proc_path, process_t *p);
 int get_proc_name(const char *proc_path, char **pname);
 int get_proc_uid(const char *proc_path, uid_t *uid);
 int get_proc_gid(const char *proc_path, gid_t *gid);
+int get_proc_stat(const char *proc_path, process_t *p);
+void get_proc_path(const process_t *p, char *path, const size_t size);
+void set_walk_target(const unsigned short root, list_t **list);
 int collect_processes();
-int handle_proc_entry(const char *fpath, const struct stat *sb,
-		      int tflag, struct FTW *ftwbuf);
+int scan_proc_threads(const char *proc_path, process_t *p, const ino_t *nids);
+int handle_proc_entry(const char *fpath, const pid_t pid);
 int insert_process_list(list_t **l, process_t *p);
 unsigned long count_process_list(list_t *l);
 process_t *search_process_list(list_t *l, const pid_t pid);
 void sort_process_list(list_t **l);
 void clear_process_list(list_t **l);
+int build_pid_index(pid_index_t **index, list_t *l);
+process_t *search_pid_index(const pid_index_t *index, const ino_t nid,
+			    const pid_t pid);
+void clear_pid_index(pid_index_t **index);
 
 #endif
@@ -0,0 +1,251 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#ifdef ALLOC_TRACK
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "profile.h"
+
+__thread profile_t profile = {.phase = PHASES};
+
+#ifdef ALLOC_TRACK
+/*
+ * The allocation tracking build (-DALLOC_TRACK) also counts the
+ * allocations and bytes of each call site, i.e. of each return address
+ * of malloc, calloc and realloc. Allocations made inside the C library,
+ * e.g. by strdup or fopen, are charged to that library function.
+ */
+typedef struct alloc_site {
+  void *caller;
+  unsigned long count;
+  unsigned long long bytes;
+} alloc_site_t;
+
+// Size of the call site table. It must be a power of two.
+#define ALLOC_SITES 1024
+
+// Number of call sites printed by --profile.
+#define ALLOC_REPORT 20
+
+static alloc_site_t alloc_sites[ALLOC_SITES];
+
+/**
+ * @name track_alloc - Account an allocation to its call site.
+ * @param caller: The return address of the allocator.
+ * @param size: The size of the allocation.
+ * @return Void.
+ *
+ * Once the table is full, the allocations of new call sites are
+ * charged to the last slot that was probed.
+ */
+static void track_alloc(void *caller, const size_t size) {
+  unsigned long slot, i;
+
+  slot = ((unsigned long)caller >> 4) & (ALLOC_SITES - 1);
+  for (i = 0; i < ALLOC_SITES - 1; i++) {
+    if (!alloc_sites[slot].caller || alloc_sites[slot].caller == caller)
+      break;
+    slot = (slot + 1) & (ALLOC_SITES - 1);
+  }
+  alloc_sites[slot].caller = caller;
+  alloc_sites[slot].count++;
+  alloc_sites[slot].bytes += size;
+}
+
+/**
+ * @name compare_alloc_sites - Order call sites by decreasing count.
+ */
+static int compare_alloc_sites(const void *a, const void *b) {
+  const alloc_site_t *x = a, *y = b;
+
+  if (x->count != y->count)
+    return x->count < y->count ? 1 : -1;
+  return 0;
+}
+
+/**
+ * @name print_alloc_sites - Print the call sites that allocate the most.
+ * @return Void.
+ *
+ * A site is shown as symbol+offset when its symbol is exported, or
+ * else as module+offset, which addr2line -f -e MODULE resolves.
+ */
+static void print_alloc_sites() {
+  Dl_info dl;
+  unsigned long i;
+
+  qsort(alloc_sites, ALLOC_SITES, sizeof(alloc_site_t), compare_alloc_sites);
+  fprintf(stderr, "Allocation sites:\n");
+  fprintf(stderr, "%10s %14s  %s\n", "count", "bytes", "site");
+  for (i = 0; i < ALLOC_REPORT && alloc_sites[i].count; i++) {
+    fprintf(stderr, "%10lu %14llu  ", alloc_sites[i].count,
+	    alloc_sites[i].bytes);
+    if (dladdr(alloc_sites[i].caller, &dl) && dl.dli_sname)
+      fprintf(stderr, "%s+0x%lx\n", dl.dli_sname,
+	      (unsigned long)((char *)alloc_sites[i].caller - (char *)dl.dli_saddr));
+    else if (dladdr(alloc_sites[i].caller, &dl) && dl.dli_fname)
+      fprintf(stderr, "%s+0x%lx\n", dl.dli_fname,
+	      (unsigned long)((char *)alloc_sites[i].caller - (char *)dl.dli_fbase));
+    else
+      fprintf(stderr, "%p\n", alloc_sites[i].caller);
+  }
+}
+
+/*
+ * The allocations are counted by wrapping the allocator of the C
+ * library, which must be the GNU C library. This also counts the
+ * buffers of stdio and the NSS lookups, which are part of the cost of
+ * a run. Memory is still released by the free of the C library.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+#define COUNT_ALLOC(size) \
+  (track_alloc(__builtin_return_address(0), (size)), \
+   profile.allocs++, profile.phase_allocs[profile.phase]++)
+
+void *malloc(size_t size) {
+  COUNT_ALLOC(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  COUNT_ALLOC(nmemb * size);
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  COUNT_ALLOC(size);
+  return __libc_realloc(ptr, size);
+}
+#endif
+
+
+/**
+ * @name get_time - Read a clock in nanoseconds.
+ * @param clock: The clock ID.
+ * @return The time in nanoseconds.
+ */
+static unsigned long long get_time(const clockid_t clock) {
+  struct timespec ts;
+
+  if (clock_gettime(clock, &ts))
+    return 0;
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @name start_phase - End the current phase and start another one.
+ * @param phase: The new phase, or PHASES to stop the profile.
+ * @return Void.
+ *
+ * A phase may be entered more than once; its times add up.
+ */
+void start_phase(const unsigned short phase) {
+  unsigned long long wall, cpu;
+
+  wall = get_time(CLOCK_MONOTONIC);
+  cpu = get_time(CLOCK_PROCESS_CPUTIME_ID);
+  if (profile.phase < PHASES) {
+    profile.wall[profile.phase] += wall - profile.wall_start;
+    profile.cpu[profile.phase] += cpu - profile.cpu_start;
+  }
+  profile.phase = phase;
+  profile.wall_start = wall;
+  profile.cpu_start = cpu;
+}
+
+/**
+ * @name merge_profile - Add the counters of this thread to another copy.
+ * @param to: Pointer to the copy of the profile.
+ * @return Void.
+ *
+ * The phase times are not merged; they are measured by the main thread.
+ */
+void merge_profile(profile_t *to) {
+  unsigned short i;
+
+  if (!to || to == &profile)
+    return;
+  to->opens += profile.opens;
+  to->bytes += profile.bytes;
+  to->stats += profile.stats;
+  to->allocs += profile.allocs;
+  to->probes += profile.probes;
+  for (i = 0; i <= PHASES; i++)
+    to->phase_allocs[i] += profile.phase_allocs[i];
+}
+
+/**
+ * @name print_profile - Print the phase times and the event counters.
+ * @return Void.
+ *
+ * The profile goes to the standard error, so that the output of the
+ * run is not changed.
+ */
+void print_profile() {
+  unsigned long long wall = 0, cpu = 0;
+  unsigned short i;
+  const char *phases[PHASES] = {
+    "init",
+    "collect",
+    "sort",
+    "build",
+    "discover",
+    "print",
+    "clear"
+  };
+
+  if (profile.phase < PHASES)
+    start_phase(PHASES);
+
+  fprintf(stderr, "Profile:\n");
+#ifdef ALLOC_TRACK
+  fprintf(stderr, "%-10s %12s %12s %12s\n", "phase", "wall_ms", "cpu_ms",
+	  "allocs");
+#else
+  fprintf(stderr, "%-10s %12s %12s\n", "phase", "wall_ms", "cpu_ms");
+#endif
+  for (i = 0; i < PHASES; i++) {
+#ifdef ALLOC_TRACK
+    fprintf(stderr, "%-10s %12.3f %12.3f %12lu\n", phases[i],
+	    profile.wall[i] / 1e6, profile.cpu[i] / 1e6, profile.phase_allocs[i]);
+#else
+    fprintf(stderr, "%-10s %12.3f %12.3f\n", phases[i],
+	    profile.wall[i] / 1e6, profile.cpu[i] / 1e6);
+#endif
+    wall += profile.wall[i];
+    cpu += profile.cpu[i];
+  }
+#ifdef ALLOC_TRACK
+  fprintf(stderr, "%-10s %12.3f %12.3f %12lu\n", "total", wall / 1e6, cpu / 1e6,
+	  profile.allocs);
+#else
+  fprintf(stderr, "%-10s %12.3f %12.3f\n", "total", wall / 1e6, cpu / 1e6);
+#endif
+  fprintf(stderr, "%-14s: %lu\n", "Files opened", profile.opens);
+  fprintf(stderr, "%-14s: %lu\n", "Bytes read", profile.bytes);
+  fprintf(stderr, "%-14s: %lu\n", "Stat calls", profile.stats);
+#ifdef ALLOC_TRACK
+  fprintf(stderr, "%-14s: %lu\n", "Allocations", profile.allocs);
+#endif
+  fprintf(stderr, "%-14s: %lu\n", "Probes", profile.probes);
+#ifdef ALLOC_TRACK
+  print_alloc_sites();
+#endif
+}
@@ -0,0 +1,55 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_PROFILE_H
+#define NSCAT_PROFILE_H
+
+// The phases of a run, in the order they are entered.
+#define PHASE_INIT     0
+#define PHASE_COLLECT  1
+#define PHASE_SORT     2
+#define PHASE_BUILD    3
+#define PHASE_DISCOVER 4
+#define PHASE_PRINT    5
+#define PHASE_CLEAR    6
+#define PHASES         7
+
+// Phase times and event counters. They are kept on every run and
+// printed with --profile. Each thread counts in its own copy, which it
+// merges into the copy of the main thread when it is done.
+typedef struct profile {
+  unsigned short phase;
+  unsigned long long wall_start;
+  unsigned long long cpu_start;
+  unsigned long long wall[PHASES];
+  unsigned long long cpu[PHASES];
+  // Only counted by the allocation tracking build.
+  unsigned long phase_allocs[PHASES + 1];
+  unsigned long opens;
+  unsigned long bytes;
+  unsigned long stats;
+  unsigned long allocs;
+  unsigned long probes;
+} profile_t;
+
+extern __thread profile_t profile;
+
+// Add n to an event counter of the profile.
+#define PROFILE_COUNT(counter, n) (profile.counter += (n))
+
+void start_phase(const unsigned short phase);
+void merge_profile(profile_t *to);
+void print_profile();
+
+#endif
@@ -0,0 +1,227 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "info.h"
+#include "namespace.h"
+#include "process.h"
+#include "stats.h"
+
+/**
+ * @name heap_push - Offer a namespace to the bounded top-N heap.
+ * @param st: Pointer to the statistics object.
+ * @param ns: Pointer to the namespace.
+ * @param members: The member count of the namespace.
+ * @return Void.
+ *
+ * The heap is a min-heap on the member count that never holds more than
+ * st->top entries, so that the N largest namespaces are found in
+ * O(n log N) time and O(N) space.
+ */
+static void heap_push(stats_t *st, namespace_t *ns, const unsigned long members) {
+  unsigned int i, c;
+
+  if (!st->top)
+    return;
+
+  if (st->heap_size < st->top) {
+    // Sift up.
+    i = st->heap_size++;
+    while (i > 0 && st->heap[(i - 1) / 2].members > members) {
+      st->heap[i] = st->heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    st->heap[i].namespace = ns;
+    st->heap[i].members = members;
+    return;
+  }
+
+  // The heap is full. Replace the smallest entry if this one is larger.
+  if (members <= st->heap[0].members)
+    return;
+  i = 0;
+  while ((c = 2 * i + 1) < st->heap_size) {
+    if (c + 1 < st->heap_size && st->heap[c + 1].members < st->heap[c].members)
+      c++;
+    if (st->heap[c].members >= members)
+      break;
+    st->heap[i] = st->heap[c];
+    i = c;
+  }
+  st->heap[i].namespace = ns;
+  st->heap[i].members = members;
+}
+
+/**
+ * @name compare_ns_count - Order namespaces by decreasing member count.
+ */
+static int compare_ns_count(const void *a, const void *b) {
+  const ns_count_t *x = a, *y = b;
+
+  if (x->members != y->members)
+    return x->members < y->members ? 1 : -1;
+  if (x->namespace->nid != y->namespace->nid)
+    return x->namespace->nid < y->namespace->nid ? -1 : 1;
+  return 0;
+}
+
+/**
+ * @name get_bucket - Get the histogram bucket of a member count.
+ * @param members: The member count.
+ * @return The bucket index. Bucket b holds counts in [2^b, 2^(b+1)).
+ */
+static unsigned int get_bucket(unsigned long members) {
+  unsigned int bucket = 0;
+
+  while (members > 1 && bucket < STATS_BUCKETS - 1) {
+    members >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+/**
+ * @name update_stats - Account the nodes of a namespace tree.
+ * @param tree: Pointer to a namespace tree.
+ * @param st: Pointer to the statistics object.
+ * @return Void.
+ */
+static void update_stats(const tree_t *tree, stats_t *st) {
+  unsigned long members;
+
+  // Siblings are visited iteratively, so that the recursion depth is
+  // bounded by the nesting depth of the tree.
+  for (; tree; tree = tree->sibling) {
+    if (tree->namespace) {
+      members = tree->namespace->nmembers;
+      st->namespaces++;
+      st->members += members;
+      if (is_orphaned_namespace(tree->namespace))
+	st->orphans++;
+      if (members)
+	st->histogram[get_bucket(members)]++;
+      st->depth[tree->depth < STATS_DEPTH ? tree->depth : STATS_DEPTH]++;
+      if (tree->depth > st->max_depth)
+	st->max_depth = tree->depth;
+      heap_push(st, tree->namespace, members);
+    }
+    update_stats(tree->child, st);
+  }
+}
+
+/**
+ * @name collect_stats - Compute the statistics of a namespace tree.
+ * @param tree: Pointer to a namespace tree.
+ * @param top: The number of largest namespaces to keep.
+ * @param heap: Space for top entries of the heap, or NULL to allocate it.
+ * @param st: Pointer to the statistics object that will be filled in.
+ * @return RET_OK on success, or an error code in case of an error.
+ */
+int collect_stats(const tree_t *tree, const unsigned int top, ns_count_t *heap,
+		  stats_t *st) {
+  if (!st) {
+    report_error("collect_stats", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return RET_ERR_PARAM;
+  }
+
+  memset(st, 0, sizeof(stats_t));
+  st->top = top;
+  st->heap = heap;
+  if (top && !heap && !(st->heap = malloc(top * sizeof(ns_count_t)))) {
+    report_error(NULL, debug_message(RET_ERR_NOMEM), ERROR_MSG);
+    return RET_ERR_NOMEM;
+  }
+  update_stats(tree, st);
+  return RET_OK;
+}
+
+/**
+ * @name print_stats - Print and release the statistics of a namespace type.
+ * @param type: The namespace type.
+ * @param st: Pointer to the statistics object.
+ * @return Void.
+ */
+void print_stats(const unsigned short type, stats_t *st) {
+  unsigned int i;
+  const char *titles[] = {
+    "Namespaces",
+    "Orphaned namespaces",
+    "Member processes",
+    "Members histogram",
+    "Depth distribution",
+    "Largest namespaces"
+  };
+  unsigned int max_width = strlen(titles[1]);
+
+  if (!st) {
+    report_error("print_stats", debug_message(RET_ERR_PARAM), DEBUG_MSG);
+    return;
+  }
+
+  printf("Namespace: %s\n", get_name_from_type(type));
+  printf("%-*s: %lu\n", max_width, titles[0], st->namespaces);
+  printf("%-*s: %lu\n", max_width, titles[1], st->orphans);
+  printf("%-*s: %lu\n", max_width, titles[2], st->members);
+
+  printf("%-*s:", max_width, titles[3]);
+  for (i = 0; i < STATS_BUCKETS; i++)
+    if (st->histogram[i]) {
+      if (i == 0)
+	printf(" [1]=%lu", st->histogram[i]);
+      else
+	printf(" [%lu-%lu]=%lu", 1UL << i, (1UL << (i + 1)) - 1, st->histogram[i]);
+    }
+  printf("\n");
+
+  printf("%-*s:", max_width, titles[4]);
+  for (i = 0; i <= STATS_DEPTH && i <= st->max_depth; i++)
+    if (st->depth[i])
+      printf(" [%u%s]=%lu", i, i == STATS_DEPTH ? "+" : "", st->depth[i]);
+  printf("\n");
+
+  if (st->heap_size) {
+    printf("%-*s:\n", max_width, titles[5]);
+    qsort(st->heap, st->heap_size, sizeof(ns_count_t), compare_ns_count);
+    for (i = 0; i < st->heap_size; i++)
+      printf("   %2u. [%s][%lu] %lu members\n", i + 1, get_name_from_type(type),
+	     st->heap[i].namespace->nid, st->heap[i].members);
+  }
+  printf("\n");
+  safe_free((void **)&(st->heap));
+  st->heap_size = 0;
+}
+
+/**
+ * @name print_all_stats - Print the statistics of the requested types.
+ * @return Void.
+ */
+void print_all_stats() {
+  unsigned short type;
+  stats_t st;
+
+  if (!info || !(info->args))
+    return;
+
+  for (type = 0; type < NSCOUNT; type++) {
+    // Skip any namespaces that the user did not requested.
+    if ((info->args->flags & FLAG_NSWANT) && !(info->args->wanted[type]))
+      continue;
+
+    if (collect_stats(info->namespace[type], info->args->top, NULL, &st) != RET_OK)
+      return;
+    print_stats(type, &st);
+  }
+}
@@ -0,0 +1,53 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_STATS_H
+#define NSCAT_STATS_H
+
+#include "namespace.h"
+
+// Member count histogram buckets (powers of two).
+#define STATS_BUCKETS 32
+
+// Deepest tree level that is counted separately.
+#define STATS_DEPTH   32
+
+// Default number of namespaces reported by --stats.
+#define STATS_TOP     10
+
+// A namespace and its member count, as kept in the top-N heap.
+typedef struct ns_count {
+  struct namespace *namespace;
+  unsigned long members;
+} ns_count_t;
+
+// Statistics for one namespace type.
+typedef struct stats {
+  unsigned long namespaces;
+  unsigned long orphans;
+  unsigned long members;
+  unsigned long histogram[STATS_BUCKETS];
+  unsigned long depth[STATS_DEPTH + 1];
+  unsigned int max_depth;
+  unsigned int top;
+  unsigned int heap_size;
+  struct ns_count *heap;
+} stats_t;
+
+int collect_stats(const tree_t *tree, const unsigned int top, ns_count_t *heap,
+		  stats_t *st);
+void print_stats(const unsigned short type, stats_t *st);
+void print_all_stats();
+
+#endif
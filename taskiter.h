@@ -0,0 +1,64 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * nscat - Print namespace information.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+#ifndef NSCAT_TASKITER_H
+#define NSCAT_TASKITER_H
+
+// This header is shared with the BPF program in bpf/taskiter.bpf.c,
+// where the kernel types come from vmlinux.h.
+#ifndef __bpf__
+#include <linux/types.h>
+#endif
+
+// Length of the command name of a task.
+#define TASKITER_COMMLEN 16
+
+// Deepest PID namespace level that is recorded.
+#define TASKITER_PIDLEVELS 8
+
+// The namespaces of a record, in this order. The names are those of
+// the files in the ns directory.
+#define TASKITER_CGROUP            0
+#define TASKITER_IPC               1
+#define TASKITER_MNT               2
+#define TASKITER_NET               3
+#define TASKITER_PID               4
+#define TASKITER_USER              5
+#define TASKITER_UTS               6
+#define TASKITER_TIME              7
+#define TASKITER_PID_FOR_CHILDREN  8
+#define TASKITER_TIME_FOR_CHILDREN 9
+#define TASKITER_NSTYPES           10
+
+// The record that the task iterator writes for each process. The
+// fields are ordered by size, so that the record has no padding and
+// the records are packed back to back in the iterator output. The size
+// field holds the size of the record, so that a program built from
+// another version of this header is detected.
+struct taskiter_record {
+  __u64 start_time;
+  __u32 size;
+  __u32 nids[TASKITER_NSTYPES];
+  __u32 pid;
+  __u32 tgid;
+  __u32 ppid;
+  __u32 uid;
+  __u32 gid;
+  __u32 threads;
+  __u32 levels;
+  __u32 nspid[TASKITER_PIDLEVELS];
+  char comm[TASKITER_COMMLEN];
+};
+
+#endif
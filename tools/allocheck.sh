@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# nscat - Print namespace information.
+#
+# Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+#
+# This is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1, as published by the Free Software
+# Foundation.  See file LICENSE.
+#
+# Allocation check. Builds nscat with allocation tracking (-DALLOC_TRACK)
+# and runs it with --profile over a synthetic procfs tree. It fails if
+# the collection phase makes more allocations per process than the
+# budget, and then prints the call sites that allocate the most.
+#
+# Usage: tools/allocheck.sh [ PROCESSES ] [ -- NSCAT_OPTIONS ]
+#
+# PROCESSES defaults to 1000. The budget can be set with ALLOC_BUDGET
+# (default 4: the process, its name, its nested PIDs and its list
+# node), the compiler with CC and the work directory with BENCH_DIR.
+# Needs the GNU C library.
+
+set -e
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+work=${BENCH_DIR:-${TMPDIR:-/tmp}/nscat-bench}
+cc=${CC:-cc}
+budget=${ALLOC_BUDGET:-4}
+
+n=1000
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    n=$1
+    shift
+fi
+[ "$1" = "--" ] && shift
+
+mkdir -p "$work"
+$cc -O2 -DALLOC_TRACK -rdynamic -o "$work/nscat-alloc" "$top"/*.c -pthread
+$cc -O2 -o "$work/mkprocfs" "$top/tools/mkprocfs.c"
+
+proc="$work/proc-$n"
+if [ ! -d "$proc" ]; then
+    $work/mkprocfs -n "$n" -f 8 -d 2 -g 3 "$proc"
+fi
+
+"$work/nscat-alloc" -m "$proc" --backend dir --profile "$@" \
+    2>"$work/allocheck-$n" >/dev/null
+allocs=$(awk '$1 == "collect" { print $4 }' "$work/allocheck-$n")
+if [ -z "$allocs" ]; then
+    echo "allocheck: no allocation counts; is this the GNU C library?" >&2
+    exit 1
+fi
+
+echo "collect: $allocs allocations for $n processes (budget $budget per process)"
+if [ "$allocs" -gt $((budget * n)) ]; then
+    echo "allocheck: FAILED" >&2
+    sed -n '/^Allocation sites:/,$p' "$work/allocheck-$n" >&2
+    exit 1
+fi
+echo "allocheck: OK"
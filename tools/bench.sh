@@ -0,0 +1,76 @@
+#!/bin/sh
+#
+# nscat - Print namespace information.
+#
+# Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+#
+# This is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License version 2.1, as published by the Free Software
+# Foundation.  See file LICENSE.
+#
+# Scaling benchmark. Builds nscat and mkprocfs, generates synthetic
+# procfs trees of several sizes and runs nscat over each of them. For
+# every size it prints the wall time, the peak RSS and the number of
+# system calls of one run.
+#
+# Usage: tools/bench.sh [ SIZES ] [ -- NSCAT_OPTIONS ]
+#
+# SIZES defaults to "1000 10000 100000". The generator options can be
+# set with MKPROCFS_OPTS (default "-f 8 -d 2 -g 3"), the compiler with
+# CC and the work directory with BENCH_DIR. Peak RSS needs GNU time and
+# the system call count needs strace; a column is "-" without them.
+
+set -e
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+work=${BENCH_DIR:-${TMPDIR:-/tmp}/nscat-bench}
+cc=${CC:-cc}
+gen_opts=${MKPROCFS_OPTS:-"-f 8 -d 2 -g 3"}
+
+sizes=
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    sizes="$sizes $1"
+    shift
+done
+[ "$1" = "--" ] && shift
+sizes=${sizes:-"1000 10000 100000"}
+
+mkdir -p "$work"
+$cc -O2 -o "$work/nscat" "$top"/*.c -pthread
+$cc -O2 -o "$work/mkprocfs" "$top/tools/mkprocfs.c"
+
+if [ -x /usr/bin/time ] && /usr/bin/time -f %M true >/dev/null 2>&1; then
+    gnu_time=/usr/bin/time
+fi
+if command -v strace >/dev/null 2>&1; then
+    have_strace=1
+fi
+
+printf "%-10s %-10s %-14s %-10s\n" processes wall_s peak_rss_kib syscalls
+for n in $sizes; do
+    proc="$work/proc-$n"
+    if [ ! -d "$proc" ]; then
+	$work/mkprocfs -n "$n" $gen_opts "$proc"
+    fi
+
+    start=$(date +%s.%N)
+    if [ -n "$gnu_time" ]; then
+	rss=$($gnu_time -f %M "$work/nscat" -m "$proc" "$@" 2>&1 >/dev/null | tail -n 1)
+    else
+	"$work/nscat" -m "$proc" "$@" >/dev/null
+	rss=-
+    fi
+    end=$(date +%s.%N)
+    wall=$(echo "$start $end" | awk '{ printf "%.3f", $2 - $1 }')
+
+    calls=-
+    if [ -n "$have_strace" ]; then
+	# One line per call; calls interrupted by another thread are
+	# split in an unfinished and a resumed line.
+	strace -f -qq -o "$work/strace-$n" "$work/nscat" -m "$proc" "$@" >/dev/null
+	calls=$(grep -vc ' resumed>' "$work/strace-$n" || true)
+    fi
+
+    printf "%-10s %-10s %-14s %-10s\n" "$n" "$wall" "$rss" "$calls"
+done
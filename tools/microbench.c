@@ -0,0 +1,413 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * microbench - Benchmark the core data structures of nscat.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+/*
+ * Each benchmark builds a synthetic input of N elements, for N = 10^3,
+ * 10^4, ... up to the maximum size, and times one operation on it: the
+ * process list (insert, search, sort) and the namespace tree (insert,
+ * search, count). For every size it prints the time per operation and
+ * the growth of that time since the previous size, as the exponent e
+ * of N^e: 0 for a constant cost per operation, 1 for a cost that grows
+ * linearly with N. A size whose run is predicted to exceed the time
+ * budget is skipped, along with the larger ones.
+ *
+ * Build from the top directory with:
+ *   cc -O2 -I. -o microbench tools/microbench.c \
+ *      $(ls *.c | grep -v '^nscat.c$') -lm -pthread
+ */
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "common.h"
+#include "info.h"
+#include "namespace.h"
+#include "process.h"
+
+// Number of lookups timed by the search benchmarks.
+#define SEARCHES 1000
+
+// The first namespace ID, as on a real host.
+#define NSBASE 4026531835UL
+
+// A benchmark. It times one operation over an input of n elements and
+// returns the elapsed seconds; ops is set to the number of operations.
+typedef struct bench {
+  const char *name;
+  double (*run)(const unsigned long n, unsigned long *ops);
+} bench_t;
+
+/**
+ * @name print_usage - Print usage information and exit.
+ * @param is_error: 1 if the function was called as a response to an error.
+ *        0 otherwise.
+ * @return Void.
+ */
+static void print_usage(const unsigned short is_error) {
+  fprintf(is_error ? stderr : stdout,
+	  "Usage: microbench [ options ] [ BENCHMARK ]...\n"
+	  "   -n, --max-size N     Largest input size (default 1000000).\n"
+	  "   -b, --budget SEC     Skip the sizes predicted to run longer\n"
+	  "                        than SEC seconds (default 10).\n"
+	  "   -s, --seed N         Seed of the random generator (default 1).\n"
+	  "   -h, --help           Print this help message and exit.\n"
+	  "The benchmarks are: insert_process_list, search_process_list,\n"
+	  "sort_process_list, insert_namespace_tree, search_namespace_tree\n"
+	  "and count_namespace_tree. All of them run by default.\n");
+  exit(is_error ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/**
+ * @name now - Read the monotonic clock.
+ * @return The time in seconds.
+ */
+static double now() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @name make_processes - Create processes with shuffled PIDs.
+ * @param n: The number of processes.
+ * @return An array of n processes with the PIDs 1 to n in random order.
+ */
+static process_t **make_processes(const unsigned long n) {
+  process_t **array, *p;
+  unsigned long i, j;
+
+  if (!(array = malloc(n * sizeof(process_t *))))
+    return NULL;
+  for (i = 0; i < n; i++) {
+    if (!(array[i] = create_empty_process()))
+      exit(EXIT_FAILURE);
+    array[i]->pid = i + 1;
+  }
+  for (i = n - 1; i > 0; i--) {
+    j = rand() % (i + 1);
+    p = array[i];
+    array[i] = array[j];
+    array[j] = p;
+  }
+  return array;
+}
+
+/**
+ * @name make_process_list - Build a process list of shuffled PIDs.
+ * @param n: The number of processes.
+ * @return The process list.
+ */
+static list_t *make_process_list(const unsigned long n) {
+  process_t **array;
+  list_t *l = NULL, *tail = NULL, *a;
+  unsigned long i;
+
+  if (!(array = make_processes(n)))
+    exit(EXIT_FAILURE);
+  // Linked here directly, so that building the input stays linear.
+  for (i = 0; i < n; i++) {
+    if (!(a = malloc(sizeof(list_t))))
+      exit(EXIT_FAILURE);
+    a->process = array[i];
+    a->next = NULL;
+    if (tail)
+      tail->next = a;
+    else
+      l = a;
+    tail = a;
+  }
+  free(array);
+  return l;
+}
+
+/**
+ * @name make_namespaces - Create namespaces that form a random tree.
+ * @param n: The number of namespaces.
+ * @return An array of n namespaces. The first one is the root and the
+ *         parent of every other one precedes it.
+ */
+static namespace_t **make_namespaces(const unsigned long n) {
+  namespace_t **array;
+  unsigned long i;
+
+  if (!(array = malloc(n * sizeof(namespace_t *))))
+    exit(EXIT_FAILURE);
+  for (i = 0; i < n; i++) {
+    if (!(array[i] = create_empty_namespace()))
+      exit(EXIT_FAILURE);
+    array[i]->type = PID;
+    array[i]->nid = NSBASE + i;
+    if (i)
+      array[i]->pnid = NSBASE + rand() % i;
+    else
+      array[i]->creator_pid = 1;
+  }
+  return array;
+}
+
+/**
+ * @name make_namespace_tree - Build a random namespace tree.
+ * @param n: The number of namespaces.
+ * @return The namespace tree.
+ *
+ * The nodes are linked here directly, so that building the input of
+ * the search and count benchmarks stays linear.
+ */
+static tree_t *make_namespace_tree(const unsigned long n) {
+  namespace_t **array;
+  tree_t **nodes, **last, *tree;
+  unsigned long i, parent;
+
+  array = make_namespaces(n);
+  if (!(nodes = malloc(n * sizeof(tree_t *))) ||
+      !(last = calloc(n, sizeof(tree_t *))))
+    exit(EXIT_FAILURE);
+  for (i = 0; i < n; i++) {
+    if (!(nodes[i] = malloc(sizeof(tree_t))))
+      exit(EXIT_FAILURE);
+    nodes[i]->namespace = array[i];
+    nodes[i]->child = NULL;
+    nodes[i]->sibling = NULL;
+    nodes[i]->depth = 0;
+    if (!i)
+      continue;
+    parent = array[i]->pnid - NSBASE;
+    nodes[i]->depth = nodes[parent]->depth + 1;
+    if (last[parent])
+      last[parent]->sibling = nodes[i];
+    else
+      nodes[parent]->child = nodes[i];
+    last[parent] = nodes[i];
+  }
+  tree = nodes[0];
+  free(last);
+  free(nodes);
+  free(array);
+  return tree;
+}
+
+static double bench_insert_process_list(const unsigned long n, unsigned long *ops) {
+  process_t **array;
+  list_t *l = NULL;
+  unsigned long i;
+  double start, elapsed;
+
+  array = make_processes(n);
+  start = now();
+  for (i = 0; i < n; i++)
+    if (insert_process_list(&l, array[i]) != RET_OK)
+      exit(EXIT_FAILURE);
+  elapsed = now() - start;
+  clear_process_list(&l);
+  free(array);
+  *ops = n;
+  return elapsed;
+}
+
+static double bench_search_process_list(const unsigned long n, unsigned long *ops) {
+  list_t *l;
+  unsigned long i, found = 0;
+  double start, elapsed;
+
+  l = make_process_list(n);
+  start = now();
+  for (i = 0; i < SEARCHES; i++)
+    if (search_process_list(l, 1 + rand() % n))
+      found++;
+  elapsed = now() - start;
+  clear_process_list(&l);
+  if (found != SEARCHES)
+    fprintf(stderr, "microbench: search_process_list missed a process\n");
+  *ops = SEARCHES;
+  return elapsed;
+}
+
+static double bench_sort_process_list(const unsigned long n, unsigned long *ops) {
+  list_t *l;
+  double start, elapsed;
+
+  l = make_process_list(n);
+  start = now();
+  sort_process_list(&l);
+  elapsed = now() - start;
+  clear_process_list(&l);
+  *ops = n;
+  return elapsed;
+}
+
+static double bench_insert_namespace_tree(const unsigned long n, unsigned long *ops) {
+  namespace_t **array;
+  tree_t *tree = NULL;
+  unsigned long i;
+  double start, elapsed;
+
+  array = make_namespaces(n);
+  start = now();
+  for (i = 0; i < n; i++)
+    if (insert_namespace_tree(&tree, array[i]) != RET_OK)
+      exit(EXIT_FAILURE);
+  elapsed = now() - start;
+  clear_namespace_tree(&tree);
+  free(array);
+  *ops = n;
+  return elapsed;
+}
+
+static double bench_search_namespace_tree(const unsigned long n, unsigned long *ops) {
+  tree_t *tree;
+  unsigned long i, found = 0;
+  double start, elapsed;
+
+  tree = make_namespace_tree(n);
+  start = now();
+  for (i = 0; i < SEARCHES; i++)
+    if (search_namespace_tree(tree, ROOT_ANY, NSBASE + rand() % n))
+      found++;
+  elapsed = now() - start;
+  clear_namespace_tree(&tree);
+  if (found != SEARCHES)
+    fprintf(stderr, "microbench: search_namespace_tree missed a namespace\n");
+  *ops = SEARCHES;
+  return elapsed;
+}
+
+static double bench_count_namespace_tree(const unsigned long n, unsigned long *ops) {
+  tree_t *tree;
+  double start, elapsed;
+
+  tree = make_namespace_tree(n);
+  start = now();
+  if (count_namespace_tree(tree) != n)
+    fprintf(stderr, "microbench: count_namespace_tree miscounted\n");
+  elapsed = now() - start;
+  clear_namespace_tree(&tree);
+  *ops = n;
+  return elapsed;
+}
+
+static const bench_t benches[] = {
+  {"insert_process_list",   bench_insert_process_list},
+  {"search_process_list",   bench_search_process_list},
+  {"sort_process_list",     bench_sort_process_list},
+  {"insert_namespace_tree", bench_insert_namespace_tree},
+  {"search_namespace_tree", bench_search_namespace_tree},
+  {"count_namespace_tree",  bench_count_namespace_tree}
+};
+#define BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+/**
+ * @name run_bench - Run a benchmark over the input sizes.
+ * @param b: The benchmark.
+ * @param max_size: The largest input size.
+ * @param budget: The time budget of one run in seconds.
+ * @return Void.
+ */
+static void run_bench(const bench_t *b, const unsigned long max_size,
+		      const double budget) {
+  unsigned long n, ops, last_n = 0;
+  double elapsed = 0, per_op, last_per_op = 0, growth = 0, predicted;
+
+  for (n = 1000; n <= max_size; n *= 10) {
+    // Assume that the cost per operation keeps growing at the last
+    // measured rate, and at least linearly in total.
+    if (last_n) {
+      predicted = elapsed * ((double)n / last_n) *
+	pow((double)n / last_n, growth > 0 ? growth : 0);
+      if (predicted > budget) {
+	printf("%-22s %9lu %12s %10s %7s  (predicted %.0f s)\n", b->name, n,
+	       "-", "-", "-", predicted);
+	break;
+      }
+    }
+
+    elapsed = b->run(n, &ops);
+    per_op = elapsed * 1e9 / ops;
+    if (last_n && last_per_op > 0 && per_op > 0)
+      growth = log(per_op / last_per_op) / log((double)n / last_n);
+    if (last_n)
+      printf("%-22s %9lu %12.1f %10.4f %7.2f\n", b->name, n, per_op, elapsed,
+	     growth);
+    else
+      printf("%-22s %9lu %12.1f %10.4f %7s\n", b->name, n, per_op, elapsed, "-");
+    fflush(stdout);
+    last_n = n;
+    last_per_op = per_op;
+  }
+}
+
+/**
+ * @name main
+ */
+int main(int argc, char *argv[]) {
+  unsigned long max_size = 1000000;
+  unsigned int seed = 1, i;
+  double budget = 10;
+  int next_option, selected = 0;
+
+  const struct option long_options[] = {
+    {"max-size", 1, NULL, 'n'},
+    {"budget",   1, NULL, 'b'},
+    {"seed",     1, NULL, 's'},
+    {"help",     0, NULL, 'h'},
+    {NULL,       0, NULL, 0}
+  };
+
+  while ((next_option = getopt_long(argc, argv, "n:b:s:h",
+				    long_options, NULL)) != -1) {
+    switch (next_option) {
+      case 'n':
+	max_size = strtoul(optarg, NULL, 10);
+	break;
+      case 'b':
+	budget = strtod(optarg, NULL);
+	break;
+      case 's':
+	seed = strtoul(optarg, NULL, 10);
+	break;
+      case 'h':
+	print_usage(0);
+      default:
+	print_usage(1);
+    }
+  }
+  if (max_size < 1000 || budget <= 0)
+    print_usage(1);
+  for (i = optind; i < (unsigned int)argc; i++) {
+    for (selected = 0; selected < (int)BENCHES; selected++)
+      if (!strcmp(argv[i], benches[selected].name))
+	break;
+    if (selected == (int)BENCHES) {
+      fprintf(stderr, "microbench: Unknown benchmark '%s'.\n", argv[i]);
+      print_usage(1);
+    }
+  }
+
+  printf("%-22s %9s %12s %10s %7s\n", "benchmark", "n", "ns/op", "total_s",
+	 "growth");
+  for (selected = 0; selected < (int)BENCHES; selected++) {
+    if (optind < argc) {
+      for (i = optind; i < (unsigned int)argc; i++)
+	if (!strcmp(argv[i], benches[selected].name))
+	  break;
+      if (i == (unsigned int)argc)
+	continue;
+    }
+    srand(seed);
+    run_bench(&benches[selected], max_size, budget);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,359 @@
+// -*- mode:C; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * mkprocfs - Build a synthetic procfs tree for nscat.
+ *
+ * Copyright (C) 2016 Giorgos Kappes <geokapp@gmail.com>
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file LICENSE.
+ *
+ */
+
+/*
+ * The tree holds one directory per process with the files nscat reads:
+ * comm, stat, status, cgroup, mountinfo, uid_map, gid_map, net/dev,
+ * net/sockstat and the ns links. Point nscat to it with -m DIR.
+ *
+ * The namespaces form a tree of nodes. The root node stands for the
+ * host and every other node for a container with its own namespace of
+ * each type. Each node has FANOUT children, down to DEPTH levels. The
+ * first process of a node is its init and the parent of the other
+ * processes of the node; the init of a child node is a child of the
+ * init of its parent node. PIDs grow with a random gap of up to GAP.
+ *
+ * Build with: cc -O2 -o mkprocfs tools/mkprocfs.c
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// The namespace files of a process, as in /proc/PID/ns.
+static const char *ns_files[] = {
+  "cgroup", "ipc", "mnt", "net", "pid", "pid_for_children",
+  "time", "time_for_children", "user", "uts"
+};
+#define NSFILES (sizeof(ns_files) / sizeof(ns_files[0]))
+
+// The first namespace ID, as on a real host.
+#define NSBASE 4026531835UL
+
+// Namespace IDs reserved per node.
+#define NSSTRIDE 16
+
+// Largest supported nesting depth.
+#define MAXDEPTH 32
+
+// A node of the namespace tree.
+typedef struct node {
+  unsigned long parent;
+  unsigned int depth;
+  pid_t init;
+  pid_t next_pid;
+} node_t;
+
+typedef struct options {
+  const char *dir;
+  unsigned long processes;
+  unsigned int fanout;
+  unsigned int depth;
+  unsigned int extents;
+  unsigned int gap;
+  unsigned int seed;
+} options_t;
+
+/**
+ * @name print_usage - Print usage information and exit.
+ * @param is_error: 1 if the function was called as a response to an error.
+ *        0 otherwise.
+ * @return Void.
+ */
+static void print_usage(const unsigned short is_error) {
+  fprintf(is_error ? stderr : stdout,
+	  "Usage: mkprocfs [ options ] DIR\n"
+	  "   -n, --processes N    Number of processes (default 1000).\n"
+	  "   -f, --fanout N       Child namespaces of each namespace (default 4).\n"
+	  "   -d, --depth N        Nesting depth of the namespaces (default 2).\n"
+	  "   -x, --extents N      UID/GID map extents of each user namespace\n"
+	  "                        (default 1).\n"
+	  "   -g, --pid-gap N      Largest gap between consecutive PIDs\n"
+	  "                        (default 1).\n"
+	  "   -s, --seed N         Seed of the random generator (default 1).\n"
+	  "   -h, --help           Print this help message.\n");
+  exit(is_error ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/**
+ * @name get_nid - Get the ID of a namespace of a node.
+ * @param node: The node index.
+ * @param file: The index of the namespace file.
+ * @return The namespace ID.
+ */
+static unsigned long get_nid(const unsigned long node, unsigned int file) {
+  // pid_for_children and time_for_children follow pid and time.
+  if (!strcmp(ns_files[file], "pid_for_children") ||
+      !strcmp(ns_files[file], "time_for_children"))
+    file--;
+  return NSBASE + node * NSSTRIDE + file;
+}
+
+/**
+ * @name write_file - Create a file with the given contents.
+ * @param dir: The directory of the file.
+ * @param name: The name of the file.
+ * @param data: The contents.
+ * @return 0 on success, -1 on error.
+ */
+static int write_file(const char *dir, const char *name, const char *data) {
+  char path[4096];
+  FILE *fd;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  if (!(fd = fopen(path, "w"))) {
+    fprintf(stderr, "mkprocfs: %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  fputs(data, fd);
+  fclose(fd);
+  return 0;
+}
+
+/**
+ * @name write_process - Create the directory of a process.
+ * @param opts: The generator options.
+ * @param nodes: The namespace tree.
+ * @param node: The node of the process.
+ * @param pid: The PID of the process.
+ * @param ppid: The PID of the parent process.
+ * @return 0 on success, -1 on error.
+ */
+static int write_process(const options_t *opts, node_t *nodes,
+			 const unsigned long node, const pid_t pid, const pid_t ppid) {
+  char dir[4096], path[4096], target[64], data[16384], nspid[512];
+  const char *comm = nodes[node].init == pid ? "init" : "worker";
+  unsigned long chain[MAXDEPTH + 1], n;
+  unsigned int i, levels, len;
+
+  snprintf(dir, sizeof(dir), "%s/%d", opts->dir, pid);
+  snprintf(path, sizeof(path), "%s/ns", dir);
+  if (mkdir(dir, 0555) && errno != EEXIST)
+    goto error;
+  if (mkdir(path, 0555) && errno != EEXIST)
+    goto error;
+  snprintf(path, sizeof(path), "%s/net", dir);
+  if (mkdir(path, 0555) && errno != EEXIST)
+    goto error;
+
+  // The PID of the process in each PID namespace, outermost first.
+  levels = nodes[node].depth + 1;
+  for (n = node, i = levels; i > 0; i--, n = nodes[n].parent)
+    chain[i - 1] = n;
+  len = snprintf(nspid, sizeof(nspid), "%d", pid);
+  for (i = 1; i < levels; i++)
+    len += snprintf(nspid + len, sizeof(nspid) - len, "\t%d",
+		    ++nodes[chain[i]].next_pid);
+
+  snprintf(data, sizeof(data), "%s\n", comm);
+  if (write_file(dir, "comm", data))
+    return -1;
+
+  snprintf(data, sizeof(data),
+	   "Name:\t%s\nUmask:\t0022\nState:\tS (sleeping)\nTgid:\t%d\n"
+	   "Ngid:\t0\nPid:\t%d\nPPid:\t%d\nTracerPid:\t0\n"
+	   "Uid:\t0\t0\t0\t0\nGid:\t0\t0\t0\t0\nFDSize:\t64\nGroups:\t\n"
+	   "NStgid:\t%s\nNSpid:\t%s\nNSpgid:\t%s\nNSsid:\t%s\n"
+	   "VmRSS:\t%d kB\nThreads:\t1\n",
+	   comm, pid, pid, ppid, nspid, nspid, nspid, nspid, 4 * (pid % 1000 + 1));
+  if (write_file(dir, "status", data))
+    return -1;
+
+  snprintf(data, sizeof(data),
+	   "%d (%s) S %d %d %d 0 -1 4194560 100 0 0 0 %d %d 0 0 20 0 1 0 %d "
+	   "10000000 %d 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 "
+	   "0 0 0 0 0 0 0 0 0 0\n",
+	   pid, comm, ppid, pid, pid, pid % 97, pid % 13, pid, pid % 1000 + 1);
+  if (write_file(dir, "stat", data))
+    return -1;
+
+  // Containers are in docker scopes with a made up ID.
+  if (node)
+    snprintf(data, sizeof(data), "0::/system.slice/docker-%012lx%052x.scope\n",
+	     node, 0);
+  else
+    snprintf(data, sizeof(data), "0::/system.slice/host.service\n");
+  if (write_file(dir, "cgroup", data))
+    return -1;
+
+  snprintf(data, sizeof(data),
+	   "%lu 1 0:%lu / / rw,relatime - overlay overlay rw\n"
+	   "%lu %lu 0:5 / /proc rw,nosuid - proc proc rw\n"
+	   "%lu %lu 0:6 / /dev rw,nosuid - tmpfs tmpfs rw\n",
+	   node * 3 + 20, node + 30, node * 3 + 21, node * 3 + 20,
+	   node * 3 + 22, node * 3 + 20);
+  if (write_file(dir, "mountinfo", data))
+    return -1;
+
+  // One extent per line. The root node maps everything.
+  if (!node) {
+    snprintf(data, sizeof(data), "%10u %10u %10u\n", 0, 0, 4294967295U);
+  } else {
+    for (len = 0, i = 0; i < opts->extents; i++)
+      len += snprintf(data + len, sizeof(data) - len, "%10u %10lu %10u\n",
+		      i * 65536, 100000 + node * 65536UL * opts->extents + i * 65536,
+		      65536);
+  }
+  if (write_file(dir, "uid_map", data) || write_file(dir, "gid_map", data))
+    return -1;
+
+  snprintf(path, sizeof(path), "%s/net", dir);
+  snprintf(data, sizeof(data),
+	   "Inter-|   Receive                            |  Transmit\n"
+	   " face |bytes    packets errs drop fifo frame compressed multicast|"
+	   "bytes    packets errs drop fifo colls carrier compressed\n"
+	   "    lo:       0       0    0    0    0     0          0         0 "
+	   "       0       0    0    0    0     0       0          0\n"
+	   "  eth0:       0       0    0    0    0     0          0         0 "
+	   "       0       0    0    0    0     0       0          0\n");
+  if (write_file(path, "dev", data))
+    return -1;
+  snprintf(data, sizeof(data), "sockets: used %lu\nTCP: inuse 0 orphan 0 tw 0 "
+	   "alloc 0 mem 0\n", node + 1);
+  if (write_file(path, "sockstat", data))
+    return -1;
+
+  // The ns links. Their targets are only read, never followed.
+  for (i = 0; i < NSFILES; i++) {
+    snprintf(path, sizeof(path), "%s/ns/%s", dir, ns_files[i]);
+    snprintf(target, sizeof(target), "%.*s:[%lu]",
+	     (int)strcspn(ns_files[i], "_"), ns_files[i], get_nid(node, i));
+    if (symlink(target, path) && errno != EEXIST)
+      goto error;
+  }
+  return 0;
+
+ error:
+  fprintf(stderr, "mkprocfs: %s: %s\n", dir, strerror(errno));
+  return -1;
+}
+
+/**
+ * @name main
+ */
+int main(int argc, char *argv[]) {
+  options_t opts = {NULL, 1000, 4, 2, 1, 1, 1};
+  unsigned long count, level_start, level_end, i, j, node;
+  char path[4096], target[32];
+  node_t *nodes;
+  pid_t pid, first;
+  int next_option;
+
+  const struct option long_options[] = {
+    {"processes", 1, NULL, 'n'},
+    {"fanout",    1, NULL, 'f'},
+    {"depth",     1, NULL, 'd'},
+    {"extents",   1, NULL, 'x'},
+    {"pid-gap",   1, NULL, 'g'},
+    {"seed",      1, NULL, 's'},
+    {"help",      0, NULL, 'h'},
+    {NULL,        0, NULL, 0}
+  };
+
+  while ((next_option = getopt_long(argc, argv, "n:f:d:x:g:s:h",
+				    long_options, NULL)) != -1) {
+    switch (next_option) {
+      case 'n':
+	opts.processes = strtoul(optarg, NULL, 10);
+	break;
+      case 'f':
+	opts.fanout = strtoul(optarg, NULL, 10);
+	break;
+      case 'd':
+	opts.depth = strtoul(optarg, NULL, 10);
+	break;
+      case 'x':
+	opts.extents = strtoul(optarg, NULL, 10);
+	break;
+      case 'g':
+	opts.gap = strtoul(optarg, NULL, 10);
+	break;
+      case 's':
+	opts.seed = strtoul(optarg, NULL, 10);
+	break;
+      case 'h':
+	print_usage(0);
+      default:
+	print_usage(1);
+    }
+  }
+  if (optind != argc - 1 || !opts.processes || !opts.gap ||
+      opts.depth > MAXDEPTH || opts.extents < 1 || opts.extents > 340)
+    print_usage(1);
+  opts.dir = argv[optind];
+  srand(opts.seed);
+
+  // Lay the nodes out level by level, stopping at one node per process.
+  for (count = 1, j = 1, i = 0; i < opts.depth && count < opts.processes; i++) {
+    j *= opts.fanout;
+    count += j;
+  }
+  if (count > opts.processes)
+    count = opts.processes;
+  if (!(nodes = calloc(count, sizeof(node_t)))) {
+    fprintf(stderr, "mkprocfs: %s\n", strerror(ENOMEM));
+    return EXIT_FAILURE;
+  }
+  for (level_start = 0, level_end = 1, node = 1; node < count; ) {
+    for (i = level_start; i < level_end && node < count; i++)
+      for (j = 0; j < opts.fanout && node < count; j++, node++) {
+	nodes[node].parent = i;
+	nodes[node].depth = nodes[i].depth + 1;
+      }
+    level_start = level_end;
+    level_end = node;
+  }
+
+  if (mkdir(opts.dir, 0755) && errno != EEXIST) {
+    fprintf(stderr, "mkprocfs: %s: %s\n", opts.dir, strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  // The inits come first, so that each node is found through its init.
+  // The remaining processes are spread at random over the nodes.
+  pid = 0;
+  first = 0;
+  for (i = 0; i < opts.processes; i++) {
+    pid += 1 + (opts.gap > 1 ? rand() % opts.gap : 0);
+    if (!first)
+      first = pid;
+    if (i < count) {
+      node = i;
+      nodes[node].init = pid;
+      if (write_process(&opts, nodes, node, pid,
+			node ? nodes[nodes[node].parent].init : 0))
+	return EXIT_FAILURE;
+    } else {
+      node = rand() % count;
+      if (write_process(&opts, nodes, node, pid, nodes[node].init))
+	return EXIT_FAILURE;
+    }
+  }
+
+  // nscat reads the namespace types from /proc/self.
+  snprintf(path, sizeof(path), "%s/self", opts.dir);
+  snprintf(target, sizeof(target), "%d", first);
+  unlink(path);
+  if (symlink(target, path)) {
+    fprintf(stderr, "mkprocfs: %s: %s\n", path, strerror(errno));
+    return EXIT_FAILURE;
+  }
+  free(nodes);
+  return EXIT_SUCCESS;
+}